@@ -0,0 +1,496 @@
+#include "allocator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Rounds size up to the next power of two.
+ */
+static VkDeviceSize next_pow2_(VkDeviceSize size) {
+    VkDeviceSize result = 1;
+    while(result < size) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/**
+ * Returns the order of a power of two node size.
+ */
+static uint32_t order_of_(VkDeviceSize node_size) {
+    uint32_t order = 0;
+    while(((VkDeviceSize)GPU_ALLOCATOR_MIN_NODE_SIZE << order) < node_size) {
+        order++;
+    }
+    return order;
+}
+
+static VkDeviceSize node_size_(uint32_t order) {
+    return (VkDeviceSize)GPU_ALLOCATOR_MIN_NODE_SIZE << order;
+}
+
+/**
+ * Makes room for one more offset in a free list.
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+static bool free_list_reserve_(buddy_free_list* list) {
+    if(list->count < list->capacity) {
+        return true;
+    }
+
+    uint32_t capacity = list->capacity == 0 ? 8 : list->capacity * 2;
+    VkDeviceSize* offsets = (VkDeviceSize*)realloc(list->offsets,
+        sizeof(VkDeviceSize) * capacity);
+    if(offsets == NULL) {
+        fprintf(stderr, "Unable to grow allocator free list\n");
+        return false;
+    }
+
+    list->offsets = offsets;
+    list->capacity = capacity;
+    return true;
+}
+
+/**
+ * Adds an offset to a free list.
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+static bool free_list_push_(buddy_free_list* list, VkDeviceSize offset) {
+    if(!free_list_reserve_(list)) {
+        return false;
+    }
+
+    list->offsets[list->count++] = offset;
+    return true;
+}
+
+/**
+ * Removes offset from the list if it's there.
+ * 
+ * Returns:
+ *   true if offset was found
+ */
+static bool free_list_remove_(buddy_free_list* list, VkDeviceSize offset) {
+    for(uint32_t i = 0; i < list->count; i++) {
+        if(list->offsets[i] == offset) {
+            list->offsets[i] = list->offsets[--list->count];
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t find_memory_type_(const gpu_allocator* allocator,
+        uint32_t type_bits, VkMemoryPropertyFlags props) {
+    for(uint32_t i = 0; i < allocator->mem_props.memoryTypeCount; i++) {
+        if((type_bits & (1u << i)) &&
+                (allocator->mem_props.memoryTypes[i].propertyFlags & props) == props) {
+            return i;
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+/**
+ * Allocates a VkDeviceMemory and maps it if it's host visible.
+ */
+static bool allocate_device_memory_(gpu_allocator* allocator,
+        uint32_t memory_type, VkDeviceSize size,
+        VkDeviceMemory* memory, void** mapped) {
+    VkMemoryAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = size;
+    alloc_info.memoryTypeIndex = memory_type;
+
+    *mapped = NULL;
+    VkResult result = vkAllocateMemory(allocator->device, &alloc_info, NULL, memory);
+
+    VkMemoryPropertyFlags flags =
+        allocator->mem_props.memoryTypes[memory_type].propertyFlags;
+
+    if(result == VK_SUCCESS && (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+        result = vkMapMemory(allocator->device, *memory, 0, VK_WHOLE_SIZE, 0, mapped);
+
+        if(result != VK_SUCCESS) {
+            vkFreeMemory(allocator->device, *memory, NULL);
+        }
+    }
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to allocate %llu bytes of memory type %i\n",
+            (unsigned long long)size, memory_type);
+        *memory = VK_NULL_HANDLE;
+    }
+
+    return result == VK_SUCCESS;
+}
+
+static void free_block_(gpu_allocator* allocator, memory_block* block) {
+    // Freeing mapped memory implicitly unmaps it
+    vkFreeMemory(allocator->device, block->memory, NULL);
+
+    for(uint32_t i = 0; i < GPU_ALLOCATOR_MAX_ORDERS; i++) {
+        free(block->free_lists[i].offsets);
+    }
+    memset(block, 0, sizeof(memory_block));
+}
+
+/**
+ * Creates a new block for a pool, reusing an empty slot if there is
+ * one.
+ * 
+ * Returns:
+ *   index of the block, or UINT32_MAX on failure
+ */
+static uint32_t add_block_(gpu_allocator* allocator, memory_pool* pool,
+        uint32_t memory_type) {
+    uint32_t heap = allocator->mem_props.memoryTypes[memory_type].heapIndex;
+    VkDeviceSize size = allocator->block_sizes[heap];
+
+    uint32_t index = pool->block_count;
+    for(uint32_t i = 0; i < pool->block_count; i++) {
+        if(pool->blocks[i].memory == VK_NULL_HANDLE) {
+            index = i;
+            break;
+        }
+    }
+
+    if(index == pool->block_count) {
+        memory_block* blocks = (memory_block*)realloc(pool->blocks,
+            sizeof(memory_block) * (pool->block_count + 1));
+        if(blocks == NULL) {
+            fprintf(stderr, "Unable to grow memory pool\n");
+            return UINT32_MAX;
+        }
+
+        pool->blocks = blocks;
+        memset(&pool->blocks[index], 0, sizeof(memory_block));
+        pool->block_count++;
+    }
+
+    memory_block* block = &pool->blocks[index];
+    if(!allocate_device_memory_(allocator, memory_type, size,
+            &block->memory, &block->mapped)) {
+        return UINT32_MAX;
+    }
+
+    block->size = size;
+    block->max_order = order_of_(size);
+
+    // A block nothing can be allocated from is no use, give it back
+    if(!free_list_push_(&block->free_lists[block->max_order], 0)) {
+        free_block_(allocator, block);
+        return UINT32_MAX;
+    }
+
+    return index;
+}
+
+/**
+ * Takes a node of the given order out of a block, splitting larger
+ * nodes as needed.
+ * 
+ * Returns:
+ *   true if the block had room
+ */
+static bool block_alloc_(memory_block* block, uint32_t order, VkDeviceSize* offset) {
+    uint32_t found = order;
+    while(found <= block->max_order && block->free_lists[found].count == 0) {
+        found++;
+    }
+
+    if(found > block->max_order) {
+        return false;
+    }
+
+    // Make room for the split halves first, so running out of memory
+    // can't lose part of the block
+    for(uint32_t i = order; i < found; i++) {
+        if(!free_list_reserve_(&block->free_lists[i])) {
+            return false;
+        }
+    }
+
+    buddy_free_list* list = &block->free_lists[found];
+    *offset = list->offsets[--list->count];
+
+    // Hand the upper half of every split back to the free lists
+    while(found > order) {
+        found--;
+        free_list_push_(&block->free_lists[found], *offset + node_size_(found));
+    }
+
+    return true;
+}
+
+/**
+ * Returns a node to a block, merging it with its buddy for as long
+ * as the buddy is free too.
+ */
+static void block_free_(memory_block* block, uint32_t order, VkDeviceSize offset) {
+    while(order < block->max_order) {
+        VkDeviceSize buddy = offset ^ node_size_(order);
+        if(!free_list_remove_(&block->free_lists[order], buddy)) {
+            break;
+        }
+
+        offset = offset < buddy ? offset : buddy;
+        order++;
+    }
+
+    // Only the node's address range is lost if this fails
+    if(!free_list_push_(&block->free_lists[order], offset)) {
+        fprintf(stderr, "Leaking %llu bytes of a memory block\n",
+            (unsigned long long)node_size_(order));
+    }
+}
+
+void init_gpu_allocator(gpu_allocator* allocator, VkDevice device,
+        VkPhysicalDevice physical_device) {
+    memset(allocator, 0, sizeof(gpu_allocator));
+    allocator->device = device;
+
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &allocator->mem_props);
+
+    for(uint32_t i = 0; i < allocator->mem_props.memoryHeapCount; i++) {
+        VkDeviceSize heap_size = allocator->mem_props.memoryHeaps[i].size;
+        VkDeviceSize block_size = GPU_ALLOCATOR_BLOCK_SIZE;
+
+        while(block_size > GPU_ALLOCATOR_MIN_NODE_SIZE && block_size > heap_size / 8) {
+            block_size >>= 1;
+        }
+
+        allocator->block_sizes[i] = block_size;
+    }
+}
+
+void cleanup_gpu_allocator(gpu_allocator* allocator) {
+    for(uint32_t type = 0; type < VK_MAX_MEMORY_TYPES; type++) {
+        for(uint32_t kind = 0; kind < GPU_RESOURCE_KIND_COUNT; kind++) {
+            memory_pool* pool = &allocator->pools[type][kind];
+
+            for(uint32_t i = 0; i < pool->block_count; i++) {
+                memory_block* block = &pool->blocks[i];
+                if(block->memory == VK_NULL_HANDLE) {
+                    continue;
+                }
+
+                if(block->allocation_count > 0) {
+                    fprintf(stderr, "%i allocations leaked from memory type %i\n",
+                        block->allocation_count, type);
+                }
+                free_block_(allocator, block);
+            }
+
+            free(pool->blocks);
+            pool->blocks = NULL;
+            pool->block_count = 0;
+        }
+    }
+
+    for(uint32_t i = 0; i < allocator->mem_props.memoryHeapCount; i++) {
+        if(allocator->dedicated_counts[i] > 0) {
+            fprintf(stderr, "%i dedicated allocations leaked from heap %i\n",
+                allocator->dedicated_counts[i], i);
+        }
+    }
+}
+
+bool gpu_allocate(gpu_allocator* allocator, const VkMemoryRequirements* reqs,
+        VkMemoryPropertyFlags props, gpu_resource_kind kind,
+        gpu_allocation* out) {
+    memset(out, 0, sizeof(gpu_allocation));
+
+    uint32_t memory_type = find_memory_type_(allocator, reqs->memoryTypeBits, props);
+    if(memory_type == UINT32_MAX) {
+        fprintf(stderr, "Unable to find suitable memory type\n");
+        return false;
+    }
+
+    uint32_t heap = allocator->mem_props.memoryTypes[memory_type].heapIndex;
+
+    out->size = reqs->size;
+    out->memory_type = memory_type;
+    out->kind = kind;
+
+    // Buddy nodes are aligned to their own size within a block, so
+    // covering the alignment covers placement too
+    VkDeviceSize node_size = reqs->size > reqs->alignment ? reqs->size : reqs->alignment;
+    if(node_size < GPU_ALLOCATOR_MIN_NODE_SIZE) {
+        node_size = GPU_ALLOCATOR_MIN_NODE_SIZE;
+    }
+    node_size = next_pow2_(node_size);
+
+    if(node_size > allocator->block_sizes[heap] / 2) {
+        out->block_index = UINT32_MAX;
+        if(!allocate_device_memory_(allocator, memory_type, reqs->size,
+                &out->memory, &out->mapped)) {
+            return false;
+        }
+
+        allocator->dedicated_counts[heap]++;
+        allocator->dedicated_bytes[heap] += reqs->size;
+        return true;
+    }
+
+    memory_pool* pool = &allocator->pools[memory_type][kind];
+    out->order = order_of_(node_size);
+
+    uint32_t index = UINT32_MAX;
+    for(uint32_t i = 0; i < pool->block_count && index == UINT32_MAX; i++) {
+        if(pool->blocks[i].memory != VK_NULL_HANDLE &&
+                block_alloc_(&pool->blocks[i], out->order, &out->offset)) {
+            index = i;
+        }
+    }
+
+    if(index == UINT32_MAX) {
+        index = add_block_(allocator, pool, memory_type);
+        if(index == UINT32_MAX) {
+            return false;
+        }
+        block_alloc_(&pool->blocks[index], out->order, &out->offset);
+    }
+
+    memory_block* block = &pool->blocks[index];
+    block->allocation_count++;
+    block->requested_bytes += reqs->size;
+    block->node_bytes += node_size;
+
+    out->block_index = index;
+    out->memory = block->memory;
+    if(block->mapped != NULL) {
+        out->mapped = (char*)block->mapped + out->offset;
+    }
+
+    return true;
+}
+
+void gpu_free(gpu_allocator* allocator, gpu_allocation* allocation) {
+    if(allocation->memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    uint32_t heap = allocator->mem_props.memoryTypes[allocation->memory_type].heapIndex;
+
+    if(allocation->block_index == UINT32_MAX) {
+        vkFreeMemory(allocator->device, allocation->memory, NULL);
+
+        allocator->dedicated_counts[heap]--;
+        allocator->dedicated_bytes[heap] -= allocation->size;
+    }
+    else {
+        memory_pool* pool = &allocator->pools[allocation->memory_type][allocation->kind];
+        memory_block* block = &pool->blocks[allocation->block_index];
+
+        block_free_(block, allocation->order, allocation->offset);
+        block->allocation_count--;
+        block->requested_bytes -= allocation->size;
+        block->node_bytes -= node_size_(allocation->order);
+
+        // Keep one empty block around per pool so a resource being
+        // recreated doesn't round trip through vkAllocateMemory
+        if(block->allocation_count == 0) {
+            bool other_block = false;
+            for(uint32_t i = 0; i < pool->block_count; i++) {
+                if(i != allocation->block_index && pool->blocks[i].memory != VK_NULL_HANDLE) {
+                    other_block = true;
+                    break;
+                }
+            }
+
+            if(other_block) {
+                free_block_(allocator, block);
+            }
+        }
+    }
+
+    memset(allocation, 0, sizeof(gpu_allocation));
+}
+
+bool gpu_allocate_buffer_memory(gpu_allocator* allocator, VkBuffer buffer,
+        VkMemoryPropertyFlags props, gpu_allocation* out) {
+    VkMemoryRequirements reqs;
+    vkGetBufferMemoryRequirements(allocator->device, buffer, &reqs);
+
+    if(!gpu_allocate(allocator, &reqs, props, GPU_RESOURCE_LINEAR, out)) {
+        return false;
+    }
+
+    if(vkBindBufferMemory(allocator->device, buffer, out->memory, out->offset) != VK_SUCCESS) {
+        fprintf(stderr, "Unable to bind buffer memory\n");
+        gpu_free(allocator, out);
+        return false;
+    }
+
+    return true;
+}
+
+bool gpu_allocate_image_memory(gpu_allocator* allocator, VkImage image,
+        VkMemoryPropertyFlags props, gpu_allocation* out) {
+    VkMemoryRequirements reqs;
+    vkGetImageMemoryRequirements(allocator->device, image, &reqs);
+
+    if(!gpu_allocate(allocator, &reqs, props, GPU_RESOURCE_OPTIMAL, out)) {
+        return false;
+    }
+
+    if(vkBindImageMemory(allocator->device, image, out->memory, out->offset) != VK_SUCCESS) {
+        fprintf(stderr, "Unable to bind image memory\n");
+        gpu_free(allocator, out);
+        return false;
+    }
+
+    return true;
+}
+
+gpu_allocator_stats get_gpu_allocator_stats(const gpu_allocator* allocator) {
+    gpu_allocator_stats stats = {};
+    stats.heap_count = allocator->mem_props.memoryHeapCount;
+
+    for(uint32_t i = 0; i < stats.heap_count; i++) {
+        stats.heaps[i].reserved_bytes = allocator->dedicated_bytes[i];
+        stats.heaps[i].used_bytes = allocator->dedicated_bytes[i];
+        stats.heaps[i].block_count = allocator->dedicated_counts[i];
+        stats.heaps[i].allocation_count = allocator->dedicated_counts[i];
+    }
+
+    for(uint32_t type = 0; type < allocator->mem_props.memoryTypeCount; type++) {
+        uint32_t heap = allocator->mem_props.memoryTypes[type].heapIndex;
+        gpu_heap_stats* heap_stats = &stats.heaps[heap];
+
+        for(uint32_t kind = 0; kind < GPU_RESOURCE_KIND_COUNT; kind++) {
+            const memory_pool* pool = &allocator->pools[type][kind];
+
+            for(uint32_t i = 0; i < pool->block_count; i++) {
+                const memory_block* block = &pool->blocks[i];
+                if(block->memory == VK_NULL_HANDLE) {
+                    continue;
+                }
+
+                VkDeviceSize largest_free = 0;
+                for(uint32_t order = block->max_order + 1; order > 0; order--) {
+                    if(block->free_lists[order - 1].count > 0) {
+                        largest_free = node_size_(order - 1);
+                        break;
+                    }
+                }
+
+                heap_stats->reserved_bytes += block->size;
+                heap_stats->used_bytes += block->requested_bytes;
+                heap_stats->wasted_bytes += block->node_bytes - block->requested_bytes;
+                heap_stats->fragmented_bytes += block->size - block->node_bytes - largest_free;
+                heap_stats->block_count++;
+                heap_stats->allocation_count += block->allocation_count;
+            }
+        }
+    }
+
+    return stats;
+}
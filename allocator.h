@@ -0,0 +1,196 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Smallest node the buddy allocator hands out
+#define GPU_ALLOCATOR_MIN_NODE_SIZE 256
+
+// Size of the device memory blocks pools are built from. Heaps too
+// small for this get blocks of an eighth of their size instead.
+#define GPU_ALLOCATOR_BLOCK_SIZE (64ull * 1024 * 1024)
+
+// Enough orders for a block of 2^31 min nodes
+#define GPU_ALLOCATOR_MAX_ORDERS 32
+
+/**
+ * Whether a resource is laid out linearly (buffers, linear images)
+ * or opaquely (optimal tiling images). The two are kept in separate
+ * pools so they never share a bufferImageGranularity page.
+ */
+typedef enum {
+    GPU_RESOURCE_LINEAR = 0,
+    GPU_RESOURCE_OPTIMAL,
+    GPU_RESOURCE_KIND_COUNT
+} gpu_resource_kind;
+
+/**
+ * Offsets of the free nodes of a single order.
+ */
+typedef struct {
+    VkDeviceSize* offsets;
+    uint32_t count;
+    uint32_t capacity;
+} buddy_free_list;
+
+/**
+ * A single vkAllocateMemory allocation split up with a buddy
+ * allocator. Host-visible blocks stay mapped for their whole life.
+ */
+typedef struct {
+    VkDeviceMemory memory;
+    void* mapped;
+    VkDeviceSize size;
+    uint32_t max_order;
+
+    // Live allocations, their requested bytes and node bytes
+    uint32_t allocation_count;
+    VkDeviceSize requested_bytes;
+    VkDeviceSize node_bytes;
+
+    buddy_free_list free_lists[GPU_ALLOCATOR_MAX_ORDERS];
+} memory_block;
+
+/**
+ * All blocks of one memory type and resource kind. Freed blocks
+ * leave an empty slot so block indices held by allocations stay
+ * valid.
+ */
+typedef struct {
+    memory_block* blocks;
+    uint32_t block_count;
+} memory_pool;
+
+/**
+ * A piece of device memory handed out by the allocator.
+ */
+typedef struct {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+
+    // Points at offset when the memory is host visible, NULL otherwise
+    void* mapped;
+
+    uint32_t memory_type;
+    gpu_resource_kind kind;
+
+    // UINT32_MAX for allocations with their own VkDeviceMemory
+    uint32_t block_index;
+    uint32_t order;
+} gpu_allocation;
+
+/**
+ * Sub-allocates device memory out of large per memory type blocks so
+ * resource count isn't bounded by maxMemoryAllocationCount.
+ * Requests larger than half a block get a dedicated allocation.
+ * 
+ * Not thread safe.
+ */
+typedef struct {
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties mem_props;
+
+    VkDeviceSize block_sizes[VK_MAX_MEMORY_HEAPS];
+    memory_pool pools[VK_MAX_MEMORY_TYPES][GPU_RESOURCE_KIND_COUNT];
+
+    // Dedicated allocations per heap
+    uint32_t dedicated_counts[VK_MAX_MEMORY_HEAPS];
+    VkDeviceSize dedicated_bytes[VK_MAX_MEMORY_HEAPS];
+} gpu_allocator;
+
+/**
+ * Memory usage of a single heap.
+ * 
+ * reserved_bytes is everything allocated from Vulkan. Of that,
+ * used_bytes was requested by resources, wasted_bytes is lost to
+ * rounding requests up to buddy nodes and fragmented_bytes is free
+ * memory outside the largest free node of each block.
+ */
+typedef struct {
+    VkDeviceSize reserved_bytes;
+    VkDeviceSize used_bytes;
+    VkDeviceSize wasted_bytes;
+    VkDeviceSize fragmented_bytes;
+
+    uint32_t block_count;
+    uint32_t allocation_count;
+} gpu_heap_stats;
+
+/**
+ * Memory usage of every heap of the device.
+ */
+typedef struct {
+    gpu_heap_stats heaps[VK_MAX_MEMORY_HEAPS];
+    uint32_t heap_count;
+} gpu_allocator_stats;
+
+/**
+ * Sets up an empty allocator for a device.
+ * 
+ * Params:
+ *   allocator       - allocator to initialize
+ *   device          - logical device
+ *   physical_device - physical device device was created from
+ */
+void init_gpu_allocator(gpu_allocator* allocator, VkDevice device,
+        VkPhysicalDevice physical_device);
+
+/**
+ * Frees every block. All allocations should have been freed first,
+ * anything left over is reported.
+ */
+void cleanup_gpu_allocator(gpu_allocator* allocator);
+
+/**
+ * Allocates memory satisfying reqs from a memory type with all of
+ * the requested property flags.
+ * 
+ * Params:
+ *   allocator - allocator
+ *   reqs      - requirements of the resource
+ *   props     - required memory property flags
+ *   kind      - whether the resource is linear or optimal
+ *   out       - receives the allocation
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool gpu_allocate(gpu_allocator* allocator, const VkMemoryRequirements* reqs,
+        VkMemoryPropertyFlags props, gpu_resource_kind kind,
+        gpu_allocation* out);
+
+/**
+ * Returns an allocation to the allocator. Freeing a zeroed
+ * allocation does nothing.
+ */
+void gpu_free(gpu_allocator* allocator, gpu_allocation* allocation);
+
+/**
+ * Allocates memory for a buffer and binds it.
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool gpu_allocate_buffer_memory(gpu_allocator* allocator, VkBuffer buffer,
+        VkMemoryPropertyFlags props, gpu_allocation* out);
+
+/**
+ * Allocates memory for an optimal tiling image and binds it.
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool gpu_allocate_image_memory(gpu_allocator* allocator, VkImage image,
+        VkMemoryPropertyFlags props, gpu_allocation* out);
+
+/**
+ * Computes used, wasted and fragmented bytes for every heap.
+ */
+gpu_allocator_stats get_gpu_allocator_stats(const gpu_allocator* allocator);
+
+#endif
@@ -0,0 +1,255 @@
+#include "bindless.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every stage the renderer uses can reach the table
+#define BINDLESS_STAGES (VK_SHADER_STAGE_VERTEX_BIT | \
+    VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+
+// Slots may be written while frames using other slots are in flight
+#define BINDLESS_BINDING_FLAGS (VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | \
+    VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | \
+    VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT)
+
+static uint32_t min_u32_(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+static bool init_slots_(bindless_slots* slots, uint32_t capacity) {
+    memset(slots, 0, sizeof(bindless_slots));
+    slots->capacity = capacity;
+    slots->free_slots = (uint32_t*)malloc(sizeof(uint32_t) * (capacity > 0 ? capacity : 1));
+
+    return slots->free_slots != NULL;
+}
+
+static uint32_t acquire_slot_(bindless_slots* slots) {
+    if(slots->free_count > 0) {
+        return slots->free_slots[--slots->free_count];
+    }
+
+    if(slots->count == slots->capacity) {
+        return BINDLESS_INDEX_NONE;
+    }
+
+    return slots->count++;
+}
+
+static void release_slot_(bindless_slots* slots, uint32_t index) {
+    if(index < slots->count && slots->free_count < slots->capacity) {
+        slots->free_slots[slots->free_count++] = index;
+    }
+}
+
+bool init_bindless_table(bindless_table* table, VkDevice device,
+        VkPhysicalDevice physical_device, layout_cache* layouts,
+        uint32_t max_buffers, uint32_t max_textures) {
+    memset(table, 0, sizeof(bindless_table));
+    table->device = device;
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexing_props = {};
+    indexing_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 props = {};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props.pNext = &indexing_props;
+
+    vkGetPhysicalDeviceProperties2(physical_device, &props);
+
+    uint32_t buffer_count = min_u32_(max_buffers, min_u32_(
+        indexing_props.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+        indexing_props.maxDescriptorSetUpdateAfterBindStorageBuffers));
+
+    // Combined image samplers count as both an image and a sampler
+    uint32_t texture_limit = min_u32_(
+        min_u32_(indexing_props.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            indexing_props.maxPerStageDescriptorUpdateAfterBindSamplers),
+        min_u32_(indexing_props.maxDescriptorSetUpdateAfterBindSampledImages,
+            indexing_props.maxDescriptorSetUpdateAfterBindSamplers));
+
+    uint32_t resource_limit = indexing_props.maxPerStageUpdateAfterBindResources;
+    if(buffer_count > resource_limit) {
+        buffer_count = resource_limit;
+    }
+    texture_limit = min_u32_(texture_limit, resource_limit - buffer_count);
+
+    // The layout declares the most textures the device allows, the
+    // set itself is only allocated as large as asked for
+    uint32_t texture_count = min_u32_(max_textures, texture_limit);
+
+    set_layout_desc* desc = &table->layout_desc;
+    desc->flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    desc->binding_count = 2;
+
+    desc->bindings[0].binding = BINDLESS_BUFFER_BINDING;
+    desc->bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    desc->bindings[0].descriptorCount = buffer_count;
+    desc->bindings[0].stageFlags = BINDLESS_STAGES;
+    desc->binding_flags[0] = BINDLESS_BINDING_FLAGS;
+
+    // Only the last binding of a set can be variable sized
+    desc->bindings[1].binding = BINDLESS_TEXTURE_BINDING;
+    desc->bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    desc->bindings[1].descriptorCount = texture_limit;
+    desc->bindings[1].stageFlags = BINDLESS_STAGES;
+    desc->binding_flags[1] = BINDLESS_BINDING_FLAGS |
+        VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+
+    if(!get_descriptor_set_layout(layouts, desc, &table->set_layout)) {
+        return false;
+    }
+
+    VkDescriptorPoolSize pool_sizes[2] = {};
+    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[0].descriptorCount = buffer_count;
+    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pool_sizes[1].descriptorCount = texture_count;
+
+    VkDescriptorPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = 2;
+    pool_info.pPoolSizes = pool_sizes;
+
+    VkResult result = vkCreateDescriptorPool(device, &pool_info, NULL, &table->pool);
+
+    if(result == VK_SUCCESS) {
+        VkDescriptorSetVariableDescriptorCountAllocateInfo count_info = {};
+        count_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        count_info.descriptorSetCount = 1;
+        count_info.pDescriptorCounts = &texture_count;
+
+        VkDescriptorSetAllocateInfo set_info = {};
+        set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        set_info.pNext = &count_info;
+        set_info.descriptorPool = table->pool;
+        set_info.descriptorSetCount = 1;
+        set_info.pSetLayouts = &table->set_layout;
+
+        result = vkAllocateDescriptorSets(device, &set_info, &table->set);
+    }
+
+    if(result != VK_SUCCESS || !init_slots_(&table->buffers, buffer_count) ||
+            !init_slots_(&table->textures, texture_count)) {
+        fprintf(stderr, "Unable to create bindless descriptor table\n");
+        cleanup_bindless_table(table);
+        return false;
+    }
+
+    printf("Bindless table holds %i buffers and %i textures\n",
+        buffer_count, texture_count);
+    return true;
+}
+
+void cleanup_bindless_table(bindless_table* table) {
+    // Destroying the pool frees the set
+    vkDestroyDescriptorPool(table->device, table->pool, NULL);
+
+    free(table->buffers.free_slots);
+    free(table->textures.free_slots);
+
+    memset(table, 0, sizeof(bindless_table));
+}
+
+uint32_t bindless_register_buffer(bindless_table* table, VkBuffer buffer,
+        VkDeviceSize offset, VkDeviceSize range) {
+    uint32_t index = acquire_slot_(&table->buffers);
+    if(index == BINDLESS_INDEX_NONE) {
+        fprintf(stderr, "Bindless table is out of buffer slots\n");
+        return index;
+    }
+
+    VkDescriptorBufferInfo buffer_info = {};
+    buffer_info.buffer = buffer;
+    buffer_info.offset = offset;
+    buffer_info.range = range;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = table->set;
+    write.dstBinding = BINDLESS_BUFFER_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &buffer_info;
+
+    vkUpdateDescriptorSets(table->device, 1, &write, 0, NULL);
+
+    return index;
+}
+
+uint32_t bindless_register_texture(bindless_table* table, VkImageView view,
+        VkSampler sampler, VkImageLayout layout) {
+    uint32_t index = acquire_slot_(&table->textures);
+    if(index == BINDLESS_INDEX_NONE) {
+        fprintf(stderr, "Bindless table is out of texture slots\n");
+        return index;
+    }
+
+    VkDescriptorImageInfo image_info = {};
+    image_info.sampler = sampler;
+    image_info.imageView = view;
+    image_info.imageLayout = layout;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = table->set;
+    write.dstBinding = BINDLESS_TEXTURE_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &image_info;
+
+    vkUpdateDescriptorSets(table->device, 1, &write, 0, NULL);
+
+    return index;
+}
+
+void bindless_release_buffer(bindless_table* table, uint32_t index) {
+    release_slot_(&table->buffers, index);
+}
+
+void bindless_release_texture(bindless_table* table, uint32_t index) {
+    release_slot_(&table->textures, index);
+}
+
+bool bindless_patch_layout(const bindless_table* table,
+        pipeline_layout_desc* desc) {
+    if(desc->set_count > BINDLESS_SET) {
+        const set_layout_desc* used = &desc->sets[BINDLESS_SET];
+
+        for(uint32_t i = 0; i < used->binding_count; i++) {
+            const VkDescriptorSetLayoutBinding* binding = &used->bindings[i];
+
+            uint32_t t = 0;
+            while(t < table->layout_desc.binding_count &&
+                    table->layout_desc.bindings[t].binding != binding->binding) {
+                t++;
+            }
+
+            // Runtime sized arrays reflect as 0 and always fit
+            if(t == table->layout_desc.binding_count ||
+                    table->layout_desc.bindings[t].descriptorType != binding->descriptorType ||
+                    table->layout_desc.bindings[t].descriptorCount < binding->descriptorCount) {
+                fprintf(stderr, "Shader binding %i of set %i doesn't match the bindless table\n",
+                    binding->binding, BINDLESS_SET);
+                return false;
+            }
+        }
+    }
+    else {
+        desc->set_count = BINDLESS_SET + 1;
+    }
+
+    desc->sets[BINDLESS_SET] = table->layout_desc;
+    return true;
+}
+
+void cmd_bind_bindless_table(VkCommandBuffer cmd, const bindless_table* table,
+        VkPipelineBindPoint bind_point, VkPipelineLayout layout) {
+    vkCmdBindDescriptorSets(cmd, bind_point, layout, BINDLESS_SET, 1,
+        &table->set, 0, NULL);
+}
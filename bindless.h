@@ -0,0 +1,135 @@
+#ifndef BINDLESS_H
+#define BINDLESS_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "layout_cache.h"
+#include "spirv_reflect.h"
+
+// Where the table lives. Shaders declare the same set and bindings:
+//   layout(set = 0, binding = 0) buffer ... buffers[];
+//   layout(set = 0, binding = 1) uniform sampler2D textures[];
+#define BINDLESS_SET 0
+#define BINDLESS_BUFFER_BINDING 0
+#define BINDLESS_TEXTURE_BINDING 1
+
+// Returned when a table is full
+#define BINDLESS_INDEX_NONE UINT32_MAX
+
+/**
+ * Slots of one binding of the table. Released slots are reused
+ * before new ones are handed out.
+ */
+typedef struct {
+    uint32_t capacity;
+    uint32_t count;
+
+    uint32_t* free_slots;
+    uint32_t free_count;
+} bindless_slots;
+
+/**
+ * A single global descriptor set holding every storage buffer and
+ * texture the renderer uses. Resources are registered once and
+ * shaders index the arrays with values passed in push constants, so
+ * drawing never updates or binds per-draw descriptor sets.
+ *
+ * Built on descriptor indexing: bindings are update-after-bind and
+ * partially bound, so registering a resource doesn't disturb frames
+ * in flight and unused slots may stay empty. The texture array is
+ * the set's variable sized binding.
+ */
+typedef struct {
+    VkDevice device;
+
+    // Set layout as pipeline layouts see it, owned by the layout cache
+    set_layout_desc layout_desc;
+    VkDescriptorSetLayout set_layout;
+
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+
+    bindless_slots buffers;
+    bindless_slots textures;
+} bindless_table;
+
+/**
+ * Creates the table. Capacities are clamped to the device's update
+ * after bind limits.
+ *
+ * Params:
+ *   table           - table to initialize
+ *   device          - logical device with descriptor indexing enabled
+ *   physical_device - physical device, for its limits
+ *   layouts         - layout cache the set layout is created through
+ *   max_buffers     - storage buffer slots
+ *   max_textures    - combined image sampler slots
+ *
+ * Returns:
+ *   bool indicating success
+ */
+bool init_bindless_table(bindless_table* table, VkDevice device,
+        VkPhysicalDevice physical_device, layout_cache* layouts,
+        uint32_t max_buffers, uint32_t max_textures);
+
+/**
+ * Destroys the descriptor set. Nothing may still be using it.
+ */
+void cleanup_bindless_table(bindless_table* table);
+
+/**
+ * Writes a storage buffer range into a free slot.
+ *
+ * Returns:
+ *   index shaders use to reach the buffer, or BINDLESS_INDEX_NONE
+ *   if the table is full
+ */
+uint32_t bindless_register_buffer(bindless_table* table, VkBuffer buffer,
+        VkDeviceSize offset, VkDeviceSize range);
+
+/**
+ * Writes a combined image sampler into a free slot.
+ *
+ * Returns:
+ *   index shaders use to reach the texture, or BINDLESS_INDEX_NONE
+ *   if the table is full
+ */
+uint32_t bindless_register_texture(bindless_table* table, VkImageView view,
+        VkSampler sampler, VkImageLayout layout);
+
+/**
+ * Returns a buffer slot for reuse. The GPU must be done with every
+ * frame that could have read it.
+ */
+void bindless_release_buffer(bindless_table* table, uint32_t index);
+
+/**
+ * Returns a texture slot for reuse. The GPU must be done with every
+ * frame that could have read it.
+ */
+void bindless_release_texture(bindless_table* table, uint32_t index);
+
+/**
+ * Replaces BINDLESS_SET of a reflected pipeline layout with the
+ * table's layout, so every pipeline is compatible with the one
+ * bound set whether its shaders use the table or not.
+ *
+ * Returns:
+ *   false if the shaders declare something in BINDLESS_SET the
+ *   table doesn't have
+ */
+bool bindless_patch_layout(const bindless_table* table,
+        pipeline_layout_desc* desc);
+
+/**
+ * Binds the table. Once per command buffer is enough, it stays bound
+ * across pipelines whose layouts were patched.
+ */
+void cmd_bind_bindless_table(VkCommandBuffer cmd, const bindless_table* table,
+        VkPipelineBindPoint bind_point, VkPipelineLayout layout);
+
+#endif
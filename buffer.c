@@ -0,0 +1,264 @@
+#include "buffer.h"
+#include "timeline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool create_gpu_buffer(gpu_allocator* allocator, VkDeviceSize size,
+        VkBufferUsageFlags usage, VkMemoryPropertyFlags props,
+        const uint32_t* queue_families, uint32_t queue_family_count,
+        gpu_buffer* out) {
+    memset(out, 0, sizeof(gpu_buffer));
+    out->size = size;
+
+    VkBufferCreateInfo buf_info = {};
+    buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buf_info.size = size;
+    buf_info.usage = usage;
+
+    if(queue_family_count > 1) {
+        buf_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        buf_info.queueFamilyIndexCount = queue_family_count;
+        buf_info.pQueueFamilyIndices = queue_families;
+    }
+    else {
+        buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VkResult result = vkCreateBuffer(allocator->device, &buf_info, NULL, &out->buffer);
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to create buffer of %llu bytes\n",
+            (unsigned long long)size);
+        return false;
+    }
+
+    if(!gpu_allocate_buffer_memory(allocator, out->buffer, props, &out->allocation)) {
+        fprintf(stderr, "Unable to back buffer with memory\n");
+        destroy_gpu_buffer(allocator, out);
+        return false;
+    }
+
+    return true;
+}
+
+void destroy_gpu_buffer(gpu_allocator* allocator, gpu_buffer* buffer) {
+    vkDestroyBuffer(allocator->device, buffer->buffer, NULL);
+    buffer->buffer = VK_NULL_HANDLE;
+
+    gpu_free(allocator, &buffer->allocation);
+}
+
+bool init_buffer_uploader(buffer_uploader* uploader, gpu_allocator* allocator,
+        VkQueue queue, uint32_t queue_family) {
+    VkDevice device = allocator->device;
+
+    uploader->device = device;
+    uploader->allocator = allocator;
+    uploader->queue = queue;
+    uploader->queue_family = queue_family;
+    uploader->cmd_pool = VK_NULL_HANDLE;
+    uploader->cmd = VK_NULL_HANDLE;
+    uploader->timeline = VK_NULL_HANDLE;
+    uploader->timeline_value = 0;
+    uploader->staging = NULL;
+    uploader->staging_count = 0;
+    uploader->staging_capacity = 0;
+    uploader->recording = false;
+
+    VkCommandPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.queueFamilyIndex = queue_family;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    VkResult result = vkCreateCommandPool(device, &pool_info, NULL,
+        &uploader->cmd_pool);
+
+    if(result == VK_SUCCESS) {
+        VkCommandBufferAllocateInfo buf_info = {};
+        buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        buf_info.commandPool = uploader->cmd_pool;
+        buf_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        buf_info.commandBufferCount = 1;
+
+        result = vkAllocateCommandBuffers(device, &buf_info, &uploader->cmd);
+    }
+
+    if(result == VK_SUCCESS &&
+            !create_timeline_semaphore(device, 0, &uploader->timeline)) {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to create buffer uploader\n");
+    }
+
+    return result == VK_SUCCESS;
+}
+
+void cleanup_buffer_uploader(buffer_uploader* uploader) {
+    for(uint32_t i = 0; i < uploader->staging_count; i++) {
+        destroy_gpu_buffer(uploader->allocator, &uploader->staging[i]);
+    }
+    free(uploader->staging);
+    uploader->staging = NULL;
+    uploader->staging_count = 0;
+    uploader->staging_capacity = 0;
+
+    vkDestroySemaphore(uploader->device, uploader->timeline, NULL);
+    vkDestroyCommandPool(uploader->device, uploader->cmd_pool, NULL);
+}
+
+bool begin_buffer_uploads(buffer_uploader* uploader) {
+    vkResetCommandPool(uploader->device, uploader->cmd_pool, 0);
+
+    VkCommandBufferBeginInfo beg_info = {};
+    beg_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beg_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    uploader->recording = vkBeginCommandBuffer(uploader->cmd, &beg_info) == VK_SUCCESS;
+
+    if(!uploader->recording) {
+        fprintf(stderr, "Unable to begin upload cmd buffer\n");
+    }
+
+    return uploader->recording;
+}
+
+bool upload_device_local_buffer(buffer_uploader* uploader, const void* data,
+        VkDeviceSize size, VkBufferUsageFlags usage, uint32_t dst_family,
+        gpu_buffer* out) {
+    if(!uploader->recording) {
+        fprintf(stderr, "Buffer upload requested outside of a batch\n");
+        return false;
+    }
+
+    if(uploader->staging_count == uploader->staging_capacity) {
+        uint32_t capacity = uploader->staging_capacity == 0 ?
+            4 : uploader->staging_capacity * 2;
+        gpu_buffer* staging = (gpu_buffer*)realloc(uploader->staging,
+            sizeof(gpu_buffer) * capacity);
+
+        // The old array still holds this batch's staging buffers
+        if(staging == NULL) {
+            fprintf(stderr, "Unable to grow staging buffer list\n");
+            return false;
+        }
+
+        uploader->staging = staging;
+        uploader->staging_capacity = capacity;
+    }
+
+    gpu_buffer* staging = &uploader->staging[uploader->staging_count];
+    bool success = create_gpu_buffer(uploader->allocator,
+        size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        NULL, 0, staging);
+
+    if(!success) {
+        return false;
+    }
+    uploader->staging_count++;
+
+    // Staging memory is host coherent and stays mapped
+    memcpy(staging->allocation.mapped, data, size);
+
+    uint32_t families[] = {uploader->queue_family, dst_family};
+    uint32_t family_count = uploader->queue_family == dst_family ? 1 : 2;
+
+    success = create_gpu_buffer(uploader->allocator,
+        size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, families, family_count, out);
+
+    if(success) {
+        VkBufferCopy region = {};
+        region.srcOffset = 0;
+        region.dstOffset = 0;
+        region.size = size;
+
+        vkCmdCopyBuffer(uploader->cmd, staging->buffer, out->buffer, 1, &region);
+    }
+
+    return success;
+}
+
+bool flush_buffer_uploads(buffer_uploader* uploader) {
+    if(!uploader->recording) {
+        return false;
+    }
+    uploader->recording = false;
+
+    VkResult result = vkEndCommandBuffer(uploader->cmd);
+
+    uint64_t signal_value = uploader->timeline_value + 1;
+
+    if(result == VK_SUCCESS) {
+        VkTimelineSemaphoreSubmitInfo timeline_info = {};
+        timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_info.signalSemaphoreValueCount = 1;
+        timeline_info.pSignalSemaphoreValues = &signal_value;
+
+        VkSubmitInfo submit_info = {};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext = &timeline_info;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &uploader->cmd;
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &uploader->timeline;
+
+        result = vkQueueSubmit(uploader->queue, 1, &submit_info, VK_NULL_HANDLE);
+    }
+
+    if(result == VK_SUCCESS) {
+        uploader->timeline_value = signal_value;
+        wait_timeline(uploader->device, uploader->timeline, signal_value);
+    }
+    else {
+        fprintf(stderr, "Unable to submit buffer uploads\n");
+        vkQueueWaitIdle(uploader->queue);
+    }
+
+    for(uint32_t i = 0; i < uploader->staging_count; i++) {
+        destroy_gpu_buffer(uploader->allocator, &uploader->staging[i]);
+    }
+    uploader->staging_count = 0;
+
+    return result == VK_SUCCESS;
+}
+
+void cmd_release_buffer_ownership(VkCommandBuffer cmd, VkBuffer buffer,
+        uint32_t src_family, uint32_t dst_family,
+        VkPipelineStageFlags src_stage, VkAccessFlags src_access) {
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = src_family;
+    barrier.dstQueueFamilyIndex = dst_family;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    // The destination half is ignored on release
+    vkCmdPipelineBarrier(cmd, src_stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0, 0, NULL, 1, &barrier, 0, NULL);
+}
+
+void cmd_acquire_buffer_ownership(VkCommandBuffer cmd, VkBuffer buffer,
+        uint32_t src_family, uint32_t dst_family,
+        VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dst_access;
+    barrier.srcQueueFamilyIndex = src_family;
+    barrier.dstQueueFamilyIndex = dst_family;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    // The source half is ignored on acquire, a semaphore orders it
+    // after the release
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst_stage,
+        0, 0, NULL, 1, &barrier, 0, NULL);
+}
@@ -0,0 +1,170 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "allocator.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A VkBuffer together with the memory backing it.
+ */
+typedef struct {
+    VkBuffer buffer;
+    gpu_allocation allocation;
+    VkDeviceSize size;
+} gpu_buffer;
+
+/**
+ * Uploads data into device-local buffers through host-visible
+ * staging buffers. Copies are recorded into a dedicated transfer
+ * command buffer between begin_buffer_uploads and
+ * flush_buffer_uploads, so any number of uploads share a single
+ * submission and wait.
+ *
+ * When the copies run on a different queue family than the one a
+ * buffer is used on, the buffer is shared concurrently between the
+ * two so no ownership transfer is needed.
+ */
+typedef struct {
+    VkDevice device;
+    gpu_allocator* allocator;
+    VkQueue queue;
+    uint32_t queue_family;
+
+    VkCommandPool cmd_pool;
+    VkCommandBuffer cmd;
+
+    // Each flush signals the next value
+    VkSemaphore timeline;
+    uint64_t timeline_value;
+
+    // Staging buffers kept alive until the copies have executed
+    gpu_buffer* staging;
+    uint32_t staging_count;
+    uint32_t staging_capacity;
+
+    bool recording;
+} buffer_uploader;
+
+/**
+ * Creates a buffer and binds memory from allocator to it. Host
+ * visible buffers come back mapped at allocation.mapped.
+ * 
+ * Params:
+ *   allocator          - device memory allocator
+ *   size               - size of the buffer in bytes
+ *   usage              - buffer usage flags
+ *   props              - required memory property flags
+ *   queue_families     - families sharing the buffer concurrently, or NULL
+ *   queue_family_count - number of queue_families, exclusive if below 2
+ *   out                - receives the buffer
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool create_gpu_buffer(gpu_allocator* allocator, VkDeviceSize size,
+        VkBufferUsageFlags usage, VkMemoryPropertyFlags props,
+        const uint32_t* queue_families, uint32_t queue_family_count,
+        gpu_buffer* out);
+
+/**
+ * Destroys a buffer and returns its memory to the allocator.
+ */
+void destroy_gpu_buffer(gpu_allocator* allocator, gpu_buffer* buffer);
+
+/**
+ * Creates the transfer command pool, command buffer and timeline
+ * semaphore used for uploads.
+ * 
+ * Params:
+ *   uploader     - uploader to initialize
+ *   allocator    - allocator buffers are created from
+ *   queue        - queue the copies are submitted to
+ *   queue_family - family of queue
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool init_buffer_uploader(buffer_uploader* uploader, gpu_allocator* allocator,
+        VkQueue queue, uint32_t queue_family);
+
+/**
+ * Destroys the uploader. Any pending uploads must have been flushed.
+ */
+void cleanup_buffer_uploader(buffer_uploader* uploader);
+
+/**
+ * Starts recording a batch of uploads.
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool begin_buffer_uploads(buffer_uploader* uploader);
+
+/**
+ * Creates a device-local buffer and records a copy of data into it
+ * from a new staging buffer. The data is copied into the staging
+ * buffer immediately, but out may not be used by the GPU until
+ * flush_buffer_uploads returns.
+ * 
+ * Params:
+ *   uploader - uploader with a batch in progress
+ *   data     - data to upload
+ *   size     - size of data in bytes
+ *   usage      - usage of the device-local buffer, TRANSFER_DST is added
+ *   dst_family - queue family the buffer will be used on
+ *   out        - receives the device-local buffer
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool upload_device_local_buffer(buffer_uploader* uploader, const void* data,
+        VkDeviceSize size, VkBufferUsageFlags usage, uint32_t dst_family,
+        gpu_buffer* out);
+
+/**
+ * Submits the current batch, waits for it to complete and frees the
+ * staging buffers.
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool flush_buffer_uploads(buffer_uploader* uploader);
+
+/**
+ * Records the release half of a queue family ownership transfer of
+ * a whole exclusive buffer. Must be paired with
+ * cmd_acquire_buffer_ownership on the destination family.
+ * 
+ * Params:
+ *   cmd        - command buffer on the source family
+ *   buffer     - buffer to transfer
+ *   src_family - current owner
+ *   dst_family - new owner
+ *   src_stage  - stages of the last writes to make available
+ *   src_access - access types of the last writes
+ */
+void cmd_release_buffer_ownership(VkCommandBuffer cmd, VkBuffer buffer,
+        uint32_t src_family, uint32_t dst_family,
+        VkPipelineStageFlags src_stage, VkAccessFlags src_access);
+
+/**
+ * Records the acquire half of a queue family ownership transfer.
+ * 
+ * Params:
+ *   cmd        - command buffer on the destination family
+ *   buffer     - buffer to transfer
+ *   src_family - previous owner
+ *   dst_family - new owner
+ *   dst_stage  - stages that will read the buffer
+ *   dst_access - access types of those reads
+ */
+void cmd_acquire_buffer_ownership(VkCommandBuffer cmd, VkBuffer buffer,
+        uint32_t src_family, uint32_t dst_family,
+        VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+
+#endif
@@ -0,0 +1,57 @@
+# Writes a C source embedding compiled SPIR-V modules as word arrays.
+#
+# Run with cmake -P and:
+#   SHADER_DIR - directory holding <name>.spv for every shader
+#   SHADERS    - comma separated shader names, e.g. shader.vert,shader.frag
+#   OUTPUT     - path of the generated C source
+
+string(REPLACE "," ";" shader_names "${SHADERS}")
+
+set(arrays "")
+set(table "")
+set(count 0)
+
+foreach(name ${shader_names})
+    file(READ "${SHADER_DIR}/${name}.spv" hex HEX)
+
+    string(LENGTH "${hex}" hex_len)
+    math(EXPR remainder "${hex_len} % 8")
+    if(hex_len EQUAL 0 OR NOT remainder EQUAL 0)
+        message(FATAL_ERROR "${name}.spv is not a whole number of SPIR-V words")
+    endif()
+
+    # SPIR-V is stored little endian, swap each group of four bytes
+    # into a word literal and break lines every eight words
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " words "${hex}")
+    set(word "0x[0-9a-f]+u, ")
+    string(REGEX REPLACE "(${word}${word}${word}${word}${word}${word}${word}${word})"
+        "\\1\n    " words "${words}")
+    string(REPLACE " \n" "\n" words "${words}")
+    string(REGEX REPLACE "[ \n]+$" "" words "${words}")
+
+    string(MAKE_C_IDENTIFIER "${name}" ident)
+
+    string(APPEND arrays "static const uint32_t ${ident}_code[] = {\n    ${words}\n};\n\n")
+    string(APPEND table "    {\"${name}\", ${ident}_code, sizeof(${ident}_code)},\n")
+    math(EXPR count "${count} + 1")
+endforeach()
+
+file(WRITE "${OUTPUT}.tmp"
+"// Generated by cmake/embed_spirv.cmake from the compiled shaders, do not edit.
+#include \"shaders.h\"
+
+${arrays}const embedded_shader EMBEDDED_SHADERS[] = {
+${table}};
+
+const uint32_t EMBEDDED_SHADER_COUNT = ${count};
+")
+
+# Only touch the output when it changed so unrelated rebuilds stay quiet
+# (file(COPY_FILE) would need CMake 3.21)
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}"
+    RESULT_VARIABLE copy_result)
+if(NOT copy_result EQUAL 0)
+    message(FATAL_ERROR "Unable to write ${OUTPUT}")
+endif()
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,40 @@
+#include "compute.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool create_compute_pipeline(VkDevice device, VkPipelineCache cache,
+        layout_cache* layouts, VkShaderModule module,
+        const pipeline_layout_desc* layout_desc, compute_pipeline* out) {
+    memset(out, 0, sizeof(compute_pipeline));
+
+    bool success = get_pipeline_layout(layouts, layout_desc, NULL, &out->layout) &&
+        build_compute_pipeline(device, cache, module, out->layout, &out->pipeline);
+
+    if(!success) {
+        fprintf(stderr, "Unable to create compute pipeline\n");
+        destroy_compute_pipeline(device, out);
+    }
+
+    return success;
+}
+
+bool build_compute_pipeline(VkDevice device, VkPipelineCache cache,
+        VkShaderModule module, VkPipelineLayout layout, VkPipeline* out) {
+    VkComputePipelineCreateInfo pipeline_info = {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = module;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = layout;
+
+    return vkCreateComputePipelines(device, cache, 1, &pipeline_info,
+        NULL, out) == VK_SUCCESS;
+}
+
+void destroy_compute_pipeline(VkDevice device, compute_pipeline* pipeline) {
+    vkDestroyPipeline(device, pipeline->pipeline, NULL);
+
+    memset(pipeline, 0, sizeof(compute_pipeline));
+}
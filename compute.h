@@ -0,0 +1,64 @@
+#ifndef COMPUTE_H
+#define COMPUTE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "layout_cache.h"
+#include "spirv_reflect.h"
+
+/**
+ * A compute pipeline. The layout belongs to the layout cache it was
+ * created with.
+ */
+typedef struct {
+    VkPipelineLayout layout;
+    VkPipeline pipeline;
+} compute_pipeline;
+
+/**
+ * Creates a compute pipeline from a shader module whose entry point
+ * is "main".
+ * 
+ * Params:
+ *   device      - logical device
+ *   cache       - pipeline cache, or VK_NULL_HANDLE
+ *   layouts     - layout cache providing the pipeline layout
+ *   module      - compute shader module
+ *   layout_desc - interface of module, usually reflected
+ *   out         - receives the pipeline
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool create_compute_pipeline(VkDevice device, VkPipelineCache cache,
+        layout_cache* layouts, VkShaderModule module,
+        const pipeline_layout_desc* layout_desc, compute_pipeline* out);
+
+/**
+ * Builds only the VkPipeline of a compute shader against an existing
+ * layout, e.g. to swap in a reloaded shader while descriptor sets
+ * allocated from the old set layout stay valid.
+ * 
+ * Params:
+ *   device - logical device
+ *   cache  - pipeline cache, or VK_NULL_HANDLE
+ *   module - compute shader module
+ *   layout - pipeline layout the shader matches
+ *   out    - receives the pipeline
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool build_compute_pipeline(VkDevice device, VkPipelineCache cache,
+        VkShaderModule module, VkPipelineLayout layout, VkPipeline* out);
+
+/**
+ * Destroys a compute pipeline. Its layout stays in the layout cache.
+ */
+void destroy_compute_pipeline(VkDevice device, compute_pipeline* pipeline);
+
+#endif
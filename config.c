@@ -0,0 +1,260 @@
+#include "config.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const uint32_t DEFAULT_WIDTH = 800;
+const uint32_t DEFAULT_HEIGHT = 600;
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t DEFAULT_HEADLESS_FRAME_COUNT = 1000;
+const uint32_t DEFAULT_INSTANCE_BENCHMARK_FRAMES = 200;
+
+// More than this only adds latency
+const uint32_t MAX_FRAMES_IN_FLIGHT = 8;
+
+typedef struct {
+    const char* name;
+    VkPresentModeKHR mode;
+} present_mode_entry;
+
+const present_mode_entry PRESENT_MODES[] = {
+    {"mailbox", VK_PRESENT_MODE_MAILBOX_KHR},
+    {"fifo", VK_PRESENT_MODE_FIFO_KHR},
+    {"fifo_relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR},
+    {"immediate", VK_PRESENT_MODE_IMMEDIATE_KHR}
+};
+const uint32_t PRESENT_MODE_COUNT = 4;
+
+/**
+ * Parses a base 10 unsigned integer, rejecting trailing garbage.
+ * strtoul would accept signs and leading whitespace, and wrap "-1"
+ * around to the largest value.
+ */
+bool parse_uint_(const char* str, uint32_t* out) {
+    if(str == NULL || !isdigit((unsigned char)str[0])) {
+        return false;
+    }
+
+    char* end = NULL;
+    unsigned long value = strtoul(str, &end, 10);
+    if(*end != '\0' || value > UINT32_MAX) {
+        return false;
+    }
+
+    *out = (uint32_t)value;
+    return true;
+}
+
+/**
+ * Parses "<width>x<height>".
+ */
+bool parse_resolution_(const char* str, uint32_t* width, uint32_t* height) {
+    if(!isdigit((unsigned char)str[0])) {
+        return false;
+    }
+
+    char* end = NULL;
+    unsigned long w = strtoul(str, &end, 10);
+    if(end == str || (*end != 'x' && *end != 'X')) {
+        return false;
+    }
+
+    const char* h_str = end + 1;
+    if(!isdigit((unsigned char)h_str[0])) {
+        return false;
+    }
+
+    unsigned long h = strtoul(h_str, &end, 10);
+    if(end == h_str || *end != '\0' || w == 0 || h == 0 ||
+            w > UINT32_MAX || h > UINT32_MAX) {
+        return false;
+    }
+
+    *width = (uint32_t)w;
+    *height = (uint32_t)h;
+    return true;
+}
+
+bool parse_present_mode_(const char* str, VkPresentModeKHR* out) {
+    for(uint32_t i = 0; i < PRESENT_MODE_COUNT; i++) {
+        if(strcmp(str, PRESENT_MODES[i].name) == 0) {
+            *out = PRESENT_MODES[i].mode;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool parse_frames_in_flight_(const char* str, uint32_t* out) {
+    uint32_t value = 0;
+    if(!parse_uint_(str, &value) || value == 0 || value > MAX_FRAMES_IN_FLIGHT) {
+        return false;
+    }
+
+    *out = value;
+    return true;
+}
+
+const char* present_mode_name(VkPresentModeKHR mode) {
+    for(uint32_t i = 0; i < PRESENT_MODE_COUNT; i++) {
+        if(PRESENT_MODES[i].mode == mode) {
+            return PRESENT_MODES[i].name;
+        }
+    }
+
+    return "unknown";
+}
+
+void init_vk_app_config(vk_app_config* config) {
+    memset(config, 0, sizeof(vk_app_config));
+
+    config->headless_frame_count = DEFAULT_HEADLESS_FRAME_COUNT;
+    config->width = DEFAULT_WIDTH;
+    config->height = DEFAULT_HEIGHT;
+    config->frames_in_flight = DEFAULT_FRAMES_IN_FLIGHT;
+    config->swapchain_image_count = 0;
+    config->present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+    config->low_latency = false;
+    config->dynamic_rendering = true;
+    config->compile_thread_count = 1;
+    config->scene_draw_count = 1;
+    config->instance_count = 1;
+    config->instance_benchmark_frames = 0;
+    config->device_override = NULL;
+}
+
+void load_vk_app_config_env(vk_app_config* config) {
+    const char* value = getenv(CONFIG_RESOLUTION_ENV);
+    if(value != NULL && !parse_resolution_(value, &config->width, &config->height)) {
+        fprintf(stderr, "Ignoring invalid %s \"%s\"\n", CONFIG_RESOLUTION_ENV, value);
+    }
+
+    value = getenv(CONFIG_FRAMES_IN_FLIGHT_ENV);
+    if(value != NULL && !parse_frames_in_flight_(value, &config->frames_in_flight)) {
+        fprintf(stderr, "Ignoring invalid %s \"%s\"\n", CONFIG_FRAMES_IN_FLIGHT_ENV, value);
+    }
+
+    value = getenv(CONFIG_SWAPCHAIN_IMAGES_ENV);
+    if(value != NULL && !parse_uint_(value, &config->swapchain_image_count)) {
+        fprintf(stderr, "Ignoring invalid %s \"%s\"\n", CONFIG_SWAPCHAIN_IMAGES_ENV, value);
+    }
+
+    value = getenv(CONFIG_PRESENT_MODE_ENV);
+    if(value != NULL && !parse_present_mode_(value, &config->present_mode)) {
+        fprintf(stderr, "Ignoring invalid %s \"%s\"\n", CONFIG_PRESENT_MODE_ENV, value);
+    }
+
+    value = getenv(CONFIG_LOW_LATENCY_ENV);
+    if(value != NULL) {
+        config->low_latency = strcmp(value, "0") != 0 && value[0] != '\0';
+    }
+
+    value = getenv(CONFIG_DYNAMIC_RENDERING_ENV);
+    if(value != NULL) {
+        config->dynamic_rendering = strcmp(value, "0") != 0 && value[0] != '\0';
+    }
+
+    value = getenv(CONFIG_HOT_RELOAD_ENV);
+    if(value != NULL) {
+        config->hot_reload = strcmp(value, "0") != 0 && value[0] != '\0';
+    }
+
+    // Empty means no override
+    value = getenv(CONFIG_DEVICE_ENV);
+    if(value != NULL && value[0] != '\0') {
+        config->device_override = value;
+    }
+}
+
+bool parse_vk_app_config_args(vk_app_config* config, int argc, char** argv) {
+    bool valid = true;
+
+    for(int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool parsed = true;
+
+        if(strcmp(arg, "--headless") == 0) {
+            config->headless = true;
+
+            // The frame count is optional
+            if(value != NULL && value[0] != '-') {
+                parsed = parse_uint_(value, &config->headless_frame_count) &&
+                    config->headless_frame_count > 0;
+                i++;
+            }
+        }
+        else if(strcmp(arg, "--resolution") == 0 && value != NULL) {
+            parsed = parse_resolution_(value, &config->width, &config->height);
+            i++;
+        }
+        else if(strcmp(arg, "--frames-in-flight") == 0 && value != NULL) {
+            parsed = parse_frames_in_flight_(value, &config->frames_in_flight);
+            i++;
+        }
+        else if(strcmp(arg, "--swapchain-images") == 0 && value != NULL) {
+            parsed = parse_uint_(value, &config->swapchain_image_count);
+            i++;
+        }
+        else if(strcmp(arg, "--present-mode") == 0 && value != NULL) {
+            parsed = parse_present_mode_(value, &config->present_mode);
+            i++;
+        }
+        else if(strcmp(arg, "--low-latency") == 0) {
+            config->low_latency = true;
+        }
+        else if(strcmp(arg, "--render-pass") == 0) {
+            config->dynamic_rendering = false;
+        }
+        else if(strcmp(arg, "--hot-reload") == 0) {
+            config->hot_reload = true;
+        }
+        else if(strcmp(arg, "--compile-threads") == 0 && value != NULL) {
+            parsed = parse_uint_(value, &config->compile_thread_count);
+            i++;
+        }
+        else if(strcmp(arg, "--threads") == 0 && value != NULL) {
+            parsed = parse_uint_(value, &config->record_thread_count);
+            i++;
+        }
+        else if(strcmp(arg, "--draws") == 0 && value != NULL) {
+            parsed = parse_uint_(value, &config->scene_draw_count) &&
+                config->scene_draw_count > 0;
+            i++;
+        }
+        else if(strcmp(arg, "--instances") == 0 && value != NULL) {
+            parsed = parse_uint_(value, &config->instance_count) &&
+                config->instance_count > 0;
+            i++;
+        }
+        else if(strcmp(arg, "--instance-benchmark") == 0) {
+            config->instance_benchmark_frames = DEFAULT_INSTANCE_BENCHMARK_FRAMES;
+
+            // The frame count is optional
+            if(value != NULL && value[0] != '-') {
+                parsed = parse_uint_(value, &config->instance_benchmark_frames) &&
+                    config->instance_benchmark_frames > 0;
+                i++;
+            }
+        }
+        else if(strcmp(arg, "--device") == 0 && value != NULL) {
+            config->device_override = value;
+            i++;
+        }
+        else {
+            fprintf(stderr, "Unknown argument \"%s\"\n", arg);
+            valid = false;
+            continue;
+        }
+
+        if(!parsed) {
+            fprintf(stderr, "Invalid value \"%s\" for %s\n", value, arg);
+            valid = false;
+        }
+    }
+
+    return valid;
+}
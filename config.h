@@ -0,0 +1,131 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Environment variables read by load_vk_app_config_env
+#define CONFIG_RESOLUTION_ENV "LEARNVK_RESOLUTION"
+#define CONFIG_FRAMES_IN_FLIGHT_ENV "LEARNVK_FRAMES_IN_FLIGHT"
+#define CONFIG_SWAPCHAIN_IMAGES_ENV "LEARNVK_SWAPCHAIN_IMAGES"
+#define CONFIG_PRESENT_MODE_ENV "LEARNVK_PRESENT_MODE"
+#define CONFIG_LOW_LATENCY_ENV "LEARNVK_LOW_LATENCY"
+#define CONFIG_DYNAMIC_RENDERING_ENV "LEARNVK_DYNAMIC_RENDERING"
+#define CONFIG_HOT_RELOAD_ENV "LEARNVK_HOT_RELOAD"
+#define CONFIG_DEVICE_ENV "LEARNVK_DEVICE"
+
+/**
+ * Runtime configuration of a vk_app, handed to init_vk_app.
+ *
+ * When headless is set no window, surface or swapchain is created.
+ * Frames are rendered into device-local images instead and
+ * run_vk_app draws headless_frame_count frames as fast as the device
+ * allows.
+ *
+ * frames_in_flight trades latency for throughput: more frames let
+ * the CPU run further ahead of the GPU. swapchain_image_count of 0
+ * asks for the surface's minimum plus one, any other count is
+ * clamped to what the surface supports. present_mode falls back to
+ * FIFO when the surface doesn't offer it.
+ *
+ * low_latency waits for the previous frame to reach the display
+ * before sampling input for the next one, when the device supports
+ * VK_KHR_present_wait. This costs throughput for latency.
+ *
+ * dynamic_rendering renders with VK_KHR_dynamic_rendering instead of
+ * a render pass and framebuffers when the device supports it.
+ *
+ * hot_reload watches the shader sources, recompiles them when they
+ * change and swaps the rebuilt pipelines in without a restart.
+ *
+ * compile_thread_count threads build graphics pipelines in the
+ * background while frames are drawn without them. Zero builds them
+ * synchronously at startup.
+ *
+ * record_thread_count worker threads record the scene's
+ * scene_draw_count draws into secondary command buffers. With zero
+ * threads everything is recorded on the main thread.
+ *
+ * Every draw renders instance_count copies of the scene from a
+ * per-instance vertex buffer. When instance_benchmark_frames is
+ * nonzero run_vk_app instead steps the instance count from 1 to a
+ * million by factors of ten, drawing that many frames at each step
+ * and reporting their frame times.
+ *
+ * device_override picks the physical device by name or UUID instead
+ * of by score.
+ */
+typedef struct {
+    bool headless;
+    uint32_t headless_frame_count;
+
+    uint32_t width;
+    uint32_t height;
+
+    uint32_t frames_in_flight;
+    uint32_t swapchain_image_count;
+    VkPresentModeKHR present_mode;
+    bool low_latency;
+    bool dynamic_rendering;
+
+    bool hot_reload;
+    uint32_t compile_thread_count;
+    uint32_t record_thread_count;
+    uint32_t scene_draw_count;
+    uint32_t instance_count;
+    uint32_t instance_benchmark_frames;
+    const char* device_override;
+} vk_app_config;
+
+/**
+ * Fills config with the defaults: an 800x600 window, two frames in
+ * flight, minimum plus one swapchain images and mailbox presentation.
+ */
+void init_vk_app_config(vk_app_config* config);
+
+/**
+ * Overrides config with any of the LEARNVK_* environment variables
+ * that are set. Invalid values are reported and ignored.
+ */
+void load_vk_app_config_env(vk_app_config* config);
+
+/**
+ * Overrides config with command line arguments. Takes precedence
+ * over the environment when called after load_vk_app_config_env.
+ * 
+ *   --headless [frame count]  render offscreen without a window
+ *   --resolution <w>x<h>      window or offscreen target size
+ *   --frames-in-flight <n>    frames the CPU may run ahead
+ *   --swapchain-images <n>    swapchain images to request
+ *   --present-mode <mode>     mailbox, fifo, fifo_relaxed or immediate
+ *   --low-latency             wait for each present before the next frame
+ *   --render-pass             use a render pass even with dynamic rendering
+ *   --hot-reload              recompile shaders when their sources change
+ *   --compile-threads <n>     build pipelines on n background threads
+ *   --threads <n>             record draws on n worker threads
+ *   --draws <n>               issue n draws per frame
+ *   --instances <n>           render n instances per draw
+ *   --instance-benchmark [frames per step]
+ *                             time 1 to 1M instances per draw
+ *   --device <name or uuid>   force a physical device
+ * 
+ * Params:
+ *   config - config to update
+ *   argc   - argument count, including the program name
+ *   argv   - arguments
+ * 
+ * Returns:
+ *   false if an argument was unknown or had an invalid value
+ */
+bool parse_vk_app_config_args(vk_app_config* config, int argc, char** argv);
+
+/**
+ * Returns the lowercase name used for a present mode on the command
+ * line, or "unknown".
+ */
+const char* present_mode_name(VkPresentModeKHR mode);
+
+#endif
@@ -0,0 +1,105 @@
+#include "dynamic_state.h"
+
+void init_draw_state(draw_state* state) {
+    state->cull_mode = VK_CULL_MODE_BACK_BIT;
+    state->front_face = VK_FRONT_FACE_CLOCKWISE;
+    state->topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    state->polygon_mode = VK_POLYGON_MODE_FILL;
+    state->primitive_restart = false;
+    state->depth_test = false;
+    state->depth_write = false;
+}
+
+void load_dynamic_state_table(VkDevice device, dynamic_state_table* table) {
+    if(table->extended) {
+        table->set_cull_mode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetCullModeEXT");
+        table->set_front_face = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetFrontFaceEXT");
+        table->set_primitive_topology = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetPrimitiveTopologyEXT");
+        table->set_depth_test_enable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetDepthTestEnableEXT");
+        table->set_depth_write_enable = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetDepthWriteEnableEXT");
+
+        table->extended = table->set_cull_mode != NULL &&
+            table->set_front_face != NULL &&
+            table->set_primitive_topology != NULL &&
+            table->set_depth_test_enable != NULL &&
+            table->set_depth_write_enable != NULL;
+    }
+
+    if(table->extended_2) {
+        table->set_primitive_restart_enable = (PFN_vkCmdSetPrimitiveRestartEnableEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetPrimitiveRestartEnableEXT");
+        table->extended_2 = table->set_primitive_restart_enable != NULL;
+    }
+
+    if(table->polygon_mode) {
+        table->set_polygon_mode = (PFN_vkCmdSetPolygonModeEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetPolygonModeEXT");
+        table->polygon_mode = table->set_polygon_mode != NULL;
+    }
+}
+
+uint32_t get_dynamic_states(const dynamic_state_table* table,
+        VkDynamicState* states) {
+    uint32_t count = 0;
+
+    states[count++] = VK_DYNAMIC_STATE_VIEWPORT;
+    states[count++] = VK_DYNAMIC_STATE_SCISSOR;
+
+    if(table->extended) {
+        states[count++] = VK_DYNAMIC_STATE_CULL_MODE_EXT;
+        states[count++] = VK_DYNAMIC_STATE_FRONT_FACE_EXT;
+        states[count++] = VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT;
+        states[count++] = VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT;
+        states[count++] = VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT;
+    }
+
+    if(table->extended_2) {
+        states[count++] = VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT;
+    }
+
+    if(table->polygon_mode) {
+        states[count++] = VK_DYNAMIC_STATE_POLYGON_MODE_EXT;
+    }
+
+    return count;
+}
+
+void cmd_set_draw_state(VkCommandBuffer cmd, const dynamic_state_table* table,
+        const draw_state* state, VkExtent2D extent) {
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float)extent.width;
+    viewport.height = (float)extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.offset.x = 0;
+    scissor.offset.y = 0;
+    scissor.extent = extent;
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    if(table->extended) {
+        table->set_cull_mode(cmd, state->cull_mode);
+        table->set_front_face(cmd, state->front_face);
+        table->set_primitive_topology(cmd, state->topology);
+        table->set_depth_test_enable(cmd, state->depth_test ? VK_TRUE : VK_FALSE);
+        table->set_depth_write_enable(cmd, state->depth_write ? VK_TRUE : VK_FALSE);
+    }
+
+    if(table->extended_2) {
+        table->set_primitive_restart_enable(cmd,
+            state->primitive_restart ? VK_TRUE : VK_FALSE);
+    }
+
+    if(table->polygon_mode) {
+        table->set_polygon_mode(cmd, state->polygon_mode);
+    }
+}
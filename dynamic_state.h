@@ -0,0 +1,96 @@
+#ifndef DYNAMIC_STATE_H
+#define DYNAMIC_STATE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Viewport, scissor and everything the extended dynamic state
+// extensions can add
+#define MAX_DYNAMIC_STATES 16
+
+/**
+ * Fixed function state of a draw. Whatever the device can set
+ * dynamically is set per draw, the rest is baked into the pipeline
+ * from the same values.
+ */
+typedef struct {
+    VkCullModeFlags cull_mode;
+    VkFrontFace front_face;
+    VkPrimitiveTopology topology;
+    VkPolygonMode polygon_mode;
+    bool primitive_restart;
+    bool depth_test;
+    bool depth_write;
+} draw_state;
+
+/**
+ * Which extended dynamic state extensions are enabled on the device
+ * and their entry points. A tier whose flag is false has NULL entry
+ * points.
+ */
+typedef struct {
+    // VK_EXT_extended_dynamic_state
+    bool extended;
+    PFN_vkCmdSetCullModeEXT set_cull_mode;
+    PFN_vkCmdSetFrontFaceEXT set_front_face;
+    PFN_vkCmdSetPrimitiveTopologyEXT set_primitive_topology;
+    PFN_vkCmdSetDepthTestEnableEXT set_depth_test_enable;
+    PFN_vkCmdSetDepthWriteEnableEXT set_depth_write_enable;
+
+    // VK_EXT_extended_dynamic_state2
+    bool extended_2;
+    PFN_vkCmdSetPrimitiveRestartEnableEXT set_primitive_restart_enable;
+
+    // VK_EXT_extended_dynamic_state3, polygon mode only
+    bool polygon_mode;
+    PFN_vkCmdSetPolygonModeEXT set_polygon_mode;
+} dynamic_state_table;
+
+/**
+ * Fills state with back face culled, clockwise, filled triangle
+ * lists without depth testing.
+ */
+void init_draw_state(draw_state* state);
+
+/**
+ * Loads the entry points of every tier flagged in table. Tiers whose
+ * entry points can't be found are disabled.
+ *
+ * Params:
+ *   device - logical device the extensions were enabled on
+ *   table  - tiers to load, updated in place
+ */
+void load_dynamic_state_table(VkDevice device, dynamic_state_table* table);
+
+/**
+ * Lists the pipeline states to mark dynamic: viewport and scissor
+ * always, plus whatever the enabled tiers cover.
+ *
+ * Params:
+ *   table  - enabled tiers
+ *   states - array of MAX_DYNAMIC_STATES to fill
+ *
+ * Returns:
+ *   number of states written
+ */
+uint32_t get_dynamic_states(const dynamic_state_table* table,
+        VkDynamicState* states);
+
+/**
+ * Records the dynamic part of state along with a viewport and
+ * scissor covering extent. Dynamic state isn't inherited, so
+ * secondary command buffers have to call this themselves.
+ *
+ * Params:
+ *   cmd    - command buffer in the recording state
+ *   table  - enabled tiers
+ *   state  - state of the upcoming draws
+ *   extent - size of the render target
+ */
+void cmd_set_draw_state(VkCommandBuffer cmd, const dynamic_state_table* table,
+        const draw_state* state, VkExtent2D extent);
+
+#endif
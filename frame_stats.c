@@ -0,0 +1,48 @@
+#include "frame_stats.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int compare_doubles_(const void* a, const void* b) {
+    double lhs = *(const double*)a;
+    double rhs = *(const double*)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+void frame_time_history_add(frame_time_history* history, double ms) {
+    history->samples[history->next] = ms;
+    history->next = (history->next + 1) % FRAME_STATS_WINDOW;
+
+    if(history->count < FRAME_STATS_WINDOW) {
+        history->count++;
+    }
+}
+
+frame_time_summary summarize_frame_times(const frame_time_history* history) {
+    frame_time_summary summary = {};
+    summary.sample_count = history->count;
+
+    if(history->count == 0) {
+        return summary;
+    }
+
+    // Sort a copy so the ring order is left intact
+    double sorted[FRAME_STATS_WINDOW];
+    memcpy(sorted, history->samples, sizeof(double) * history->count);
+    qsort(sorted, history->count, sizeof(double), compare_doubles_);
+
+    double total = 0.0;
+    for(uint32_t i = 0; i < history->count; i++) {
+        total += sorted[i];
+    }
+
+    uint32_t p99_index = (uint32_t)ceil(history->count * 0.99) - 1;
+
+    summary.min_ms = sorted[0];
+    summary.avg_ms = total / history->count;
+    summary.p99_ms = sorted[p99_index];
+
+    return summary;
+}
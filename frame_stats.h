@@ -0,0 +1,61 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdint.h>
+
+// Number of frames the rolling statistics are computed over
+#define FRAME_STATS_WINDOW 256
+
+/**
+ * Ring buffer holding the most recent frame times in milliseconds.
+ */
+typedef struct {
+    double samples[FRAME_STATS_WINDOW];
+    uint32_t count;
+    uint32_t next;
+} frame_time_history;
+
+/**
+ * Summary of the frame times currently held in a history.
+ */
+typedef struct {
+    double min_ms;
+    double avg_ms;
+    double p99_ms;
+    uint32_t sample_count;
+} frame_time_summary;
+
+/**
+ * Rolling GPU and CPU frame time statistics for a vk_app. cpu is
+ * the time spent recording and submitting a frame. present_latency
+ * is the time from sampling input to the frame being displayed,
+ * only measured in low latency mode.
+ */
+typedef struct {
+    frame_time_summary gpu;
+    frame_time_summary cpu;
+    frame_time_summary present_latency;
+} vk_app_frame_stats;
+
+/**
+ * Adds a frame time to the history, replacing the oldest sample once
+ * the window is full.
+ * 
+ * Params:
+ *   history - frame time history
+ *   ms      - frame time in milliseconds
+ */
+void frame_time_history_add(frame_time_history* history, double ms);
+
+/**
+ * Computes min, average and 99th percentile over the history.
+ * 
+ * Params:
+ *   history - frame time history
+ * 
+ * Returns:
+ *   frame_time_summary, all zero if there are no samples
+ */
+frame_time_summary summarize_frame_times(const frame_time_history* history);
+
+#endif
@@ -0,0 +1,243 @@
+#include "layout_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+/**
+ * Folds a word into an FNV-1a hash a byte at a time. Descriptions
+ * are hashed field by field so padding and unused array entries
+ * never affect the result.
+ */
+static uint64_t hash_word_(uint64_t hash, uint64_t word) {
+    for(uint32_t i = 0; i < sizeof(word); i++) {
+        hash ^= (word >> (i * 8)) & 0xFF;
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static uint64_t hash_set_layout_(const set_layout_desc* desc) {
+    uint64_t hash = hash_word_(FNV_OFFSET_BASIS, desc->binding_count);
+    hash = hash_word_(hash, desc->flags);
+
+    for(uint32_t i = 0; i < desc->binding_count; i++) {
+        const VkDescriptorSetLayoutBinding* binding = &desc->bindings[i];
+        hash = hash_word_(hash, binding->binding);
+        hash = hash_word_(hash, binding->descriptorType);
+        hash = hash_word_(hash, binding->descriptorCount);
+        hash = hash_word_(hash, binding->stageFlags);
+        hash = hash_word_(hash, desc->binding_flags[i]);
+    }
+
+    return hash;
+}
+
+static bool set_layouts_equal_(const set_layout_desc* a, const set_layout_desc* b) {
+    if(a->binding_count != b->binding_count || a->flags != b->flags) {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < a->binding_count; i++) {
+        const VkDescriptorSetLayoutBinding* x = &a->bindings[i];
+        const VkDescriptorSetLayoutBinding* y = &b->bindings[i];
+
+        if(x->binding != y->binding || x->descriptorType != y->descriptorType ||
+                x->descriptorCount != y->descriptorCount ||
+                x->stageFlags != y->stageFlags ||
+                a->binding_flags[i] != b->binding_flags[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Makes room for one more entry in a growable array.
+ *
+ * Returns:
+ *   bool indicating success
+ */
+static bool reserve_entry_(void** entries, uint32_t count, uint32_t* capacity,
+        size_t entry_size) {
+    if(count < *capacity) {
+        return true;
+    }
+
+    uint32_t new_capacity = *capacity > 0 ? *capacity * 2 : 8;
+    void* grown = realloc(*entries, new_capacity * entry_size);
+    if(grown == NULL) {
+        return false;
+    }
+
+    *entries = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+void init_layout_cache(layout_cache* cache, VkDevice device) {
+    memset(cache, 0, sizeof(layout_cache));
+    cache->device = device;
+
+    for(uint32_t i = 0; i < LAYOUT_CACHE_BUCKETS; i++) {
+        cache->set_buckets[i] = LAYOUT_CACHE_NONE;
+        cache->pipeline_buckets[i] = LAYOUT_CACHE_NONE;
+    }
+}
+
+void cleanup_layout_cache(layout_cache* cache) {
+    if(cache->set_layout_count + cache->pipeline_layout_count > 0) {
+        printf("Layout cache: %u set layouts, %u pipeline layouts, %u hits, %u misses\n",
+            cache->set_layout_count, cache->pipeline_layout_count,
+            cache->hits, cache->misses);
+    }
+
+    for(uint32_t i = 0; i < cache->pipeline_layout_count; i++) {
+        vkDestroyPipelineLayout(cache->device, cache->pipeline_layouts[i].layout, NULL);
+    }
+
+    for(uint32_t i = 0; i < cache->set_layout_count; i++) {
+        vkDestroyDescriptorSetLayout(cache->device, cache->set_layouts[i].layout, NULL);
+    }
+
+    free(cache->pipeline_layouts);
+    free(cache->set_layouts);
+
+    init_layout_cache(cache, VK_NULL_HANDLE);
+}
+
+bool get_descriptor_set_layout(layout_cache* cache, const set_layout_desc* desc,
+        VkDescriptorSetLayout* out) {
+    uint64_t hash = hash_set_layout_(desc);
+    uint32_t* bucket = &cache->set_buckets[hash % LAYOUT_CACHE_BUCKETS];
+
+    for(uint32_t i = *bucket; i != LAYOUT_CACHE_NONE; i = cache->set_layouts[i].next) {
+        const set_layout_entry* entry = &cache->set_layouts[i];
+
+        if(entry->hash == hash && set_layouts_equal_(&entry->key, desc)) {
+            cache->hits++;
+            *out = entry->layout;
+            return true;
+        }
+    }
+
+    if(!reserve_entry_((void**)&cache->set_layouts, cache->set_layout_count,
+                &cache->set_layout_capacity, sizeof(set_layout_entry))) {
+        fprintf(stderr, "Unable to grow layout cache\n");
+        return false;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.flags = desc->flags;
+    layout_info.bindingCount = desc->binding_count;
+    layout_info.pBindings = desc->bindings;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info = {};
+    flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flags_info.bindingCount = desc->binding_count;
+    flags_info.pBindingFlags = desc->binding_flags;
+
+    // Only chained when needed, it requires descriptor indexing
+    for(uint32_t i = 0; i < desc->binding_count; i++) {
+        if(desc->binding_flags[i] != 0) {
+            layout_info.pNext = &flags_info;
+        }
+    }
+
+    VkDescriptorSetLayout layout;
+    if(vkCreateDescriptorSetLayout(cache->device, &layout_info, NULL,
+                &layout) != VK_SUCCESS) {
+        fprintf(stderr, "Failed to create descriptor set layout\n");
+        return false;
+    }
+
+    set_layout_entry* entry = &cache->set_layouts[cache->set_layout_count];
+    entry->hash = hash;
+    entry->next = *bucket;
+    entry->key = *desc;
+    entry->layout = layout;
+    *bucket = cache->set_layout_count++;
+
+    cache->misses++;
+    *out = layout;
+    return true;
+}
+
+bool get_pipeline_layout(layout_cache* cache, const pipeline_layout_desc* desc,
+        VkDescriptorSetLayout* set_layouts, VkPipelineLayout* out) {
+    // Set layouts are deduplicated first, so pipeline layouts can be
+    // keyed by their handles
+    VkDescriptorSetLayout sets[REFLECT_MAX_SETS];
+    uint64_t hash = hash_word_(FNV_OFFSET_BASIS, desc->set_count);
+
+    for(uint32_t i = 0; i < desc->set_count; i++) {
+        if(!get_descriptor_set_layout(cache, &desc->sets[i], &sets[i])) {
+            return false;
+        }
+        hash = hash_word_(hash, (uint64_t)(uintptr_t)sets[i]);
+    }
+
+    const VkPushConstantRange* push = &desc->push_constants;
+    hash = hash_word_(hash, push->stageFlags);
+    hash = hash_word_(hash, push->offset);
+    hash = hash_word_(hash, push->size);
+
+    if(set_layouts != NULL) {
+        memcpy(set_layouts, sets, desc->set_count * sizeof(VkDescriptorSetLayout));
+    }
+
+    uint32_t* bucket = &cache->pipeline_buckets[hash % LAYOUT_CACHE_BUCKETS];
+
+    for(uint32_t i = *bucket; i != LAYOUT_CACHE_NONE; i = cache->pipeline_layouts[i].next) {
+        const pipeline_layout_entry* entry = &cache->pipeline_layouts[i];
+
+        if(entry->hash == hash && entry->set_count == desc->set_count &&
+                memcmp(entry->sets, sets, desc->set_count * sizeof(VkDescriptorSetLayout)) == 0 &&
+                entry->push_constants.stageFlags == push->stageFlags &&
+                entry->push_constants.offset == push->offset &&
+                entry->push_constants.size == push->size) {
+            cache->hits++;
+            *out = entry->layout;
+            return true;
+        }
+    }
+
+    if(!reserve_entry_((void**)&cache->pipeline_layouts, cache->pipeline_layout_count,
+                &cache->pipeline_layout_capacity, sizeof(pipeline_layout_entry))) {
+        fprintf(stderr, "Unable to grow layout cache\n");
+        return false;
+    }
+
+    VkPipelineLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.setLayoutCount = desc->set_count;
+    layout_info.pSetLayouts = sets;
+    layout_info.pushConstantRangeCount = push->size > 0 ? 1 : 0;
+    layout_info.pPushConstantRanges = push;
+
+    VkPipelineLayout layout;
+    if(vkCreatePipelineLayout(cache->device, &layout_info, NULL,
+                &layout) != VK_SUCCESS) {
+        fprintf(stderr, "Failed to create pipeline layout\n");
+        return false;
+    }
+
+    pipeline_layout_entry* entry = &cache->pipeline_layouts[cache->pipeline_layout_count];
+    entry->hash = hash;
+    entry->next = *bucket;
+    memcpy(entry->sets, sets, desc->set_count * sizeof(VkDescriptorSetLayout));
+    entry->set_count = desc->set_count;
+    entry->push_constants = *push;
+    entry->layout = layout;
+    *bucket = cache->pipeline_layout_count++;
+
+    cache->misses++;
+    *out = layout;
+    return true;
+}
@@ -0,0 +1,101 @@
+#ifndef LAYOUT_CACHE_H
+#define LAYOUT_CACHE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "spirv_reflect.h"
+
+#define LAYOUT_CACHE_BUCKETS 64
+
+// Terminates a bucket chain
+#define LAYOUT_CACHE_NONE UINT32_MAX
+
+typedef struct {
+    uint64_t hash;
+    uint32_t next;
+
+    set_layout_desc key;
+    VkDescriptorSetLayout layout;
+} set_layout_entry;
+
+typedef struct {
+    uint64_t hash;
+    uint32_t next;
+
+    VkDescriptorSetLayout sets[REFLECT_MAX_SETS];
+    uint32_t set_count;
+    VkPushConstantRange push_constants;
+
+    VkPipelineLayout layout;
+} pipeline_layout_entry;
+
+/**
+ * Creates descriptor set and pipeline layouts on demand and hands
+ * out the same handle for identical descriptions, so pipelines built
+ * from shaders with matching interfaces share layouts and can share
+ * descriptor sets. The cache owns every layout it returns.
+ *
+ * Not thread safe.
+ */
+typedef struct {
+    VkDevice device;
+
+    set_layout_entry* set_layouts;
+    uint32_t set_layout_count;
+    uint32_t set_layout_capacity;
+    uint32_t set_buckets[LAYOUT_CACHE_BUCKETS];
+
+    pipeline_layout_entry* pipeline_layouts;
+    uint32_t pipeline_layout_count;
+    uint32_t pipeline_layout_capacity;
+    uint32_t pipeline_buckets[LAYOUT_CACHE_BUCKETS];
+
+    uint32_t hits;
+    uint32_t misses;
+} layout_cache;
+
+void init_layout_cache(layout_cache* cache, VkDevice device);
+
+/**
+ * Destroys every layout created through the cache. Nothing may
+ * still be using them.
+ */
+void cleanup_layout_cache(layout_cache* cache);
+
+/**
+ * Returns the set layout for a set of bindings, creating it on first
+ * use. Runtime sized bindings must have their descriptorCount filled
+ * in by the caller.
+ *
+ * Params:
+ *   cache - layout cache
+ *   desc  - bindings, sorted by binding number
+ *   out   - receives the layout
+ *
+ * Returns:
+ *   bool indicating success
+ */
+bool get_descriptor_set_layout(layout_cache* cache, const set_layout_desc* desc,
+        VkDescriptorSetLayout* out);
+
+/**
+ * Returns the pipeline layout for a merged shader interface, along
+ * with its set layouts, creating them on first use.
+ *
+ * Params:
+ *   cache       - layout cache
+ *   desc        - merged interface of the pipeline's stages
+ *   set_layouts - receives desc->set_count set layouts, may be NULL
+ *   out         - receives the pipeline layout
+ *
+ * Returns:
+ *   bool indicating success
+ */
+bool get_pipeline_layout(layout_cache* cache, const pipeline_layout_desc* desc,
+        VkDescriptorSetLayout* set_layouts, VkPipelineLayout* out);
+
+#endif
@@ -1,13 +1,25 @@
-
 #include "vk_app.h"
 
 #include <stdio.h>
 
-int main() {
-    glfwInit();
+int main(int argc, char** argv) {
+    vk_app app = {};
+
+    // Defaults, overridden by the environment, overridden by arguments
+    vk_app_config config;
+    init_vk_app_config(&config);
+    load_vk_app_config_env(&config);
+
+    if(!parse_vk_app_config_args(&config, argc, argv)) {
+        fprintf(stderr, "Invalid arguments. Exiting\n");
+        return 1;
+    }
+
+    if(!config.headless) {
+        glfwInit();
+    }
 
-    vk_app app;
-    int initialized = init_vk_app(&app);
+    int initialized = init_vk_app(&app, &config);
 
     if(initialized) {
         run_vk_app(&app);
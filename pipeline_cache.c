@@ -0,0 +1,151 @@
+#include "pipeline_cache.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/**
+ * Checks that a cache blob was written by the driver and device
+ * we are running on. Drivers are supposed to reject foreign blobs
+ * themselves, but not all of them do so gracefully.
+ * 
+ * Params:
+ *   data            - cache blob
+ *   size            - size of the blob in bytes
+ *   physical_device - physical device to match against
+ * 
+ * Returns:
+ *   bool indicating if the blob can be used
+ */
+static bool validate_cache_header_(const void* data, size_t size,
+        VkPhysicalDevice physical_device) {
+    VkPipelineCacheHeaderVersionOne header;
+
+    if(size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physical_device, &props);
+
+    return header.headerSize >= sizeof(header) &&
+        header.headerSize <= size &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == props.vendorID &&
+        header.deviceID == props.deviceID &&
+        memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID,
+                VK_UUID_SIZE) == 0;
+}
+
+VkPipelineCache load_pipeline_cache(VkDevice device,
+        VkPhysicalDevice physical_device, const char* path) {
+    size_t size = 0;
+    uint32_t* data = NULL;
+
+    // A missing cache is the normal first run, read_file would
+    // report it as an error
+    FILE* existing = fopen(path, "rb");
+    if(existing != NULL) {
+        fclose(existing);
+        data = read_file(path, &size);
+    }
+    else {
+        printf("No pipeline cache at \"%s\" yet, starting empty\n", path);
+    }
+
+    VkPipelineCacheCreateInfo cache_info = {};
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if(data != NULL && validate_cache_header_(data, size, physical_device)) {
+        cache_info.initialDataSize = size;
+        cache_info.pInitialData = data;
+        printf("Loaded %zu byte pipeline cache from \"%s\"\n", size, path);
+    }
+    else if(data != NULL) {
+        printf("Ignoring pipeline cache \"%s\" from a different device or driver\n", path);
+    }
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    VkResult result = vkCreatePipelineCache(device, &cache_info, NULL, &cache);
+
+    // Some drivers still refuse a blob that passed the header check
+    if(result != VK_SUCCESS && cache_info.initialDataSize != 0) {
+        fprintf(stderr, "Driver rejected pipeline cache, starting empty\n");
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = NULL;
+        result = vkCreatePipelineCache(device, &cache_info, NULL, &cache);
+    }
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to create pipeline cache\n");
+        cache = VK_NULL_HANDLE;
+    }
+
+    free(data);
+    data = NULL;
+
+    return cache;
+}
+
+bool save_pipeline_cache(VkDevice device, VkPipelineCache cache,
+        const char* path) {
+    if(cache == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    size_t size = 0;
+    VkResult result = vkGetPipelineCacheData(device, cache, &size, NULL);
+    if(result != VK_SUCCESS || size == 0) {
+        return false;
+    }
+
+    void* data = malloc(size);
+    result = vkGetPipelineCacheData(device, cache, &size, data);
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to read pipeline cache data\n");
+        free(data);
+        return false;
+    }
+
+    size_t tmp_len = strlen(path) + 5;
+    char* tmp_path = (char*)malloc(tmp_len);
+    snprintf(tmp_path, tmp_len, "%s.tmp", path);
+
+    bool success = false;
+    FILE* f = fopen(tmp_path, "wb");
+    if(f != NULL) {
+        success = fwrite(data, 1, size, f) == size;
+        success &= fclose(f) == 0;
+
+        if(success) {
+#ifdef _WIN32
+            success = MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+            success = rename(tmp_path, path) == 0;
+#endif
+        }
+
+        if(!success) {
+            remove(tmp_path);
+        }
+    }
+
+    if(success) {
+        printf("Wrote %zu byte pipeline cache to \"%s\"\n", size, path);
+    }
+    else {
+        fprintf(stderr, "Unable to write pipeline cache to \"%s\"\n", path);
+    }
+
+    free(tmp_path);
+    free(data);
+
+    return success;
+}
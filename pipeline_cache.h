@@ -0,0 +1,41 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+
+/**
+ * Creates a pipeline cache, seeding it with the blob stored at path
+ * if one exists and was produced by the same driver and device.
+ * Stale or foreign blobs are ignored and an empty cache is created.
+ * 
+ * Params:
+ *   device          - logical device
+ *   physical_device - physical device the blob must match
+ *   path            - location of the cache blob on disk
+ * 
+ * Returns:
+ *   the new pipeline cache, or VK_NULL_HANDLE on failure
+ */
+VkPipelineCache load_pipeline_cache(VkDevice device,
+        VkPhysicalDevice physical_device, const char* path);
+
+/**
+ * Writes the contents of the pipeline cache to path. The data is
+ * written to a temporary file first and then renamed over path so
+ * a crash never leaves a truncated cache behind.
+ * 
+ * Params:
+ *   device - logical device
+ *   cache  - pipeline cache to serialize
+ *   path   - destination of the cache blob
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool save_pipeline_cache(VkDevice device, VkPipelineCache cache,
+        const char* path);
+
+#endif
@@ -0,0 +1,413 @@
+#include "pipeline_compiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool build_graphics_pipeline(VkDevice device, VkPipelineCache cache,
+        const graphics_pipeline_desc* desc, VkPipeline* out) {
+    VkPipelineShaderStageCreateInfo vert_stage_info = {};
+    vert_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vert_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vert_stage_info.module = desc->vert_module;
+    vert_stage_info.pName = "main";
+
+    VkPipelineShaderStageCreateInfo frag_stage_info = {};
+    frag_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    frag_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    frag_stage_info.module = desc->frag_module;
+    frag_stage_info.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shader_stages[] = {
+        vert_stage_info,
+        frag_stage_info
+    };
+
+    // Vertex Info
+    VkPipelineVertexInputStateCreateInfo vert_input_info = {};
+    vert_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vert_input_info.vertexBindingDescriptionCount = desc->binding_count;
+    vert_input_info.pVertexBindingDescriptions = desc->bindings;
+    vert_input_info.vertexAttributeDescriptionCount = desc->attribute_count;
+    vert_input_info.pVertexAttributeDescriptions = desc->attributes;
+
+    // Whatever the device can set per draw is dynamic, these values
+    // only matter for the rest
+    const draw_state* state = &desc->state;
+
+    // Topology info
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_info = {};
+    input_assembly_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly_info.topology = state->topology;
+    input_assembly_info.primitiveRestartEnable = state->primitive_restart ? VK_TRUE : VK_FALSE;
+
+    // Viewport & scissor are set at record time
+    VkPipelineViewportStateCreateInfo vp_info = {};
+    vp_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    vp_info.viewportCount = 1;
+    vp_info.pViewports = NULL;
+    vp_info.scissorCount = 1;
+    vp_info.pScissors = NULL;
+
+    VkDynamicState dynamic_states[MAX_DYNAMIC_STATES];
+    VkPipelineDynamicStateCreateInfo dynamic_info = {};
+    dynamic_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_info.dynamicStateCount = get_dynamic_states(&desc->dynamic_state,
+        dynamic_states);
+    dynamic_info.pDynamicStates = dynamic_states;
+
+    // Rasterizer
+    VkPipelineRasterizationStateCreateInfo rast_info = {};
+    rast_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rast_info.depthClampEnable = VK_FALSE;
+    rast_info.rasterizerDiscardEnable = VK_FALSE;
+    rast_info.polygonMode = state->polygon_mode;
+    rast_info.lineWidth = 1.0f;
+    rast_info.cullMode = state->cull_mode;
+    rast_info.frontFace = state->front_face;
+    rast_info.depthBiasEnable = VK_FALSE;
+    rast_info.depthBiasConstantFactor = 0.0f;
+    rast_info.depthBiasClamp = 0.0f;
+    rast_info.depthBiasSlopeFactor = 0.0f;    
+
+    // Multisampling
+    VkPipelineMultisampleStateCreateInfo multi_info = {};
+    multi_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multi_info.sampleShadingEnable = VK_FALSE;
+    multi_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multi_info.minSampleShading = 1.0f;
+    multi_info.pSampleMask = NULL;
+    multi_info.alphaToCoverageEnable = VK_FALSE;
+    multi_info.alphaToOneEnable = VK_FALSE;
+
+    // Color blending
+    VkPipelineColorBlendAttachmentState blend_attachment = {};
+    blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | 
+        VK_COLOR_COMPONENT_G_BIT | 
+        VK_COLOR_COMPONENT_B_BIT |
+        VK_COLOR_COMPONENT_A_BIT;
+    blend_attachment.blendEnable = VK_FALSE;
+    blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo blend_info = {};
+    blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    blend_info.logicOpEnable = VK_FALSE;
+    blend_info.logicOp = VK_LOGIC_OP_COPY;
+    blend_info.attachmentCount = 1;
+    blend_info.pAttachments = &blend_attachment;
+    blend_info.blendConstants[0] = 0.0f;
+    blend_info.blendConstants[1] = 0.0f;
+    blend_info.blendConstants[2] = 0.0f;
+    blend_info.blendConstants[3] = 0.0f;
+
+    VkGraphicsPipelineCreateInfo pipeline_info = {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.stageCount = 2;
+    pipeline_info.pStages = shader_stages;
+    pipeline_info.pVertexInputState = &vert_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly_info;
+    pipeline_info.pViewportState = &vp_info;
+    pipeline_info.pRasterizationState = &rast_info;
+    pipeline_info.pMultisampleState = &multi_info;
+    pipeline_info.pDepthStencilState = NULL;
+    pipeline_info.pColorBlendState = &blend_info;
+    pipeline_info.pDynamicState = &dynamic_info;
+
+    // Dynamic rendering pipelines only need the attachment formats
+    VkPipelineRenderingCreateInfoKHR rendering_info = {};
+    rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    rendering_info.colorAttachmentCount = 1;
+    rendering_info.pColorAttachmentFormats = &desc->color_format;
+
+    if(desc->render_pass == VK_NULL_HANDLE) {
+        pipeline_info.pNext = &rendering_info;
+    }
+
+    pipeline_info.layout = desc->layout;
+    pipeline_info.renderPass = desc->render_pass;
+    pipeline_info.subpass = 0;
+    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+    pipeline_info.basePipelineIndex = -1;
+
+    VkResult result = vkCreateGraphicsPipelines(device, cache,
+        1, &pipeline_info, NULL, out);
+
+    return result == VK_SUCCESS;
+}
+
+/**
+ * Takes the oldest pending slot off the queue. Called with the lock
+ * held and a non-empty queue.
+ */
+static uint32_t pop_pending_(pipeline_compiler* compiler) {
+    uint32_t index = compiler->queue_head;
+
+    compiler->queue_head = compiler->slots[index].next;
+    if(compiler->queue_head == PIPELINE_HANDLE_NONE) {
+        compiler->queue_tail = PIPELINE_HANDLE_NONE;
+    }
+
+    return index;
+}
+
+/**
+ * Stores the result of a compile. Pipelines released while they
+ * were compiling are destroyed right away. Called with the lock
+ * held.
+ */
+static void finish_slot_(pipeline_compiler* compiler, uint32_t index,
+        bool built, VkPipeline pipeline) {
+    pipeline_slot* slot = &compiler->slots[index];
+
+    if(slot->released) {
+        vkDestroyPipeline(compiler->device, pipeline, NULL);
+        memset(slot, 0, sizeof(pipeline_slot));
+        return;
+    }
+
+    slot->pipeline = pipeline;
+    slot->status = built ? PIPELINE_READY : PIPELINE_FAILED;
+
+    if(!built) {
+        fprintf(stderr, "Failed to compile graphics pipeline %i\n", index);
+    }
+}
+
+/**
+ * Compile thread entry point. Builds queued pipelines one at a time
+ * until the compiler shuts down.
+ */
+static void* compile_main_(void* arg) {
+    pipeline_compiler* compiler = (pipeline_compiler*)arg;
+
+    pthread_mutex_lock(&compiler->lock);
+    while(true) {
+        while(!compiler->shutdown && compiler->queue_head == PIPELINE_HANDLE_NONE) {
+            pthread_cond_wait(&compiler->work_ready, &compiler->lock);
+        }
+
+        if(compiler->shutdown) {
+            break;
+        }
+
+        // Slots may be reallocated by submit, work on a copy
+        uint32_t index = pop_pending_(compiler);
+        graphics_pipeline_desc desc = compiler->slots[index].desc;
+        compiler->compiling++;
+        pthread_mutex_unlock(&compiler->lock);
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        bool built = build_graphics_pipeline(compiler->device, compiler->cache,
+            &desc, &pipeline);
+
+        vkDestroyShaderModule(compiler->device, desc.frag_module, NULL);
+        vkDestroyShaderModule(compiler->device, desc.vert_module, NULL);
+
+        pthread_mutex_lock(&compiler->lock);
+        finish_slot_(compiler, index, built, pipeline);
+
+        compiler->compiling--;
+        pthread_cond_broadcast(&compiler->work_done);
+    }
+    pthread_mutex_unlock(&compiler->lock);
+
+    return NULL;
+}
+
+bool init_pipeline_compiler(pipeline_compiler* compiler, VkDevice device,
+        VkPipelineCache cache, uint32_t thread_count) {
+    memset(compiler, 0, sizeof(pipeline_compiler));
+    compiler->device = device;
+    compiler->cache = cache;
+    compiler->queue_head = PIPELINE_HANDLE_NONE;
+    compiler->queue_tail = PIPELINE_HANDLE_NONE;
+
+    pthread_mutex_init(&compiler->lock, NULL);
+    pthread_cond_init(&compiler->work_ready, NULL);
+    pthread_cond_init(&compiler->work_done, NULL);
+
+    compiler->threads = (pthread_t*)calloc(thread_count, sizeof(pthread_t));
+
+    bool success = true;
+    for(uint32_t i = 0; i < thread_count && success; i++) {
+        success = pthread_create(&compiler->threads[i], NULL, compile_main_,
+                compiler) == 0;
+
+        if(success) {
+            compiler->thread_count++;
+        }
+    }
+
+    if(success) {
+        printf("Started %i pipeline compile threads\n", compiler->thread_count);
+    }
+    else {
+        fprintf(stderr, "Unable to start %i pipeline compile threads\n", thread_count);
+        cleanup_pipeline_compiler(compiler);
+    }
+
+    return success;
+}
+
+void cleanup_pipeline_compiler(pipeline_compiler* compiler) {
+    pthread_mutex_lock(&compiler->lock);
+    compiler->shutdown = true;
+    pthread_cond_broadcast(&compiler->work_ready);
+    pthread_mutex_unlock(&compiler->lock);
+
+    for(uint32_t i = 0; i < compiler->thread_count; i++) {
+        pthread_join(compiler->threads[i], NULL);
+    }
+    free(compiler->threads);
+    compiler->threads = NULL;
+    compiler->thread_count = 0;
+
+    // Whatever is still queued never got to own a pipeline
+    while(compiler->queue_head != PIPELINE_HANDLE_NONE) {
+        pipeline_slot* slot = &compiler->slots[pop_pending_(compiler)];
+
+        vkDestroyShaderModule(compiler->device, slot->desc.frag_module, NULL);
+        vkDestroyShaderModule(compiler->device, slot->desc.vert_module, NULL);
+    }
+
+    for(uint32_t i = 0; i < compiler->slot_count; i++) {
+        vkDestroyPipeline(compiler->device, compiler->slots[i].pipeline, NULL);
+    }
+    free(compiler->slots);
+    compiler->slots = NULL;
+    compiler->slot_count = 0;
+
+    pthread_cond_destroy(&compiler->work_done);
+    pthread_cond_destroy(&compiler->work_ready);
+    pthread_mutex_destroy(&compiler->lock);
+}
+
+pipeline_handle pipeline_compiler_submit(pipeline_compiler* compiler,
+        const graphics_pipeline_desc* desc) {
+    pthread_mutex_lock(&compiler->lock);
+
+    // Reuse a released slot before growing
+    uint32_t index = 0;
+    while(index < compiler->slot_count && compiler->slots[index].in_use) {
+        index++;
+    }
+
+    if(index == compiler->slot_count) {
+        uint32_t capacity = compiler->slot_count > 0 ? compiler->slot_count * 2 : 4;
+        pipeline_slot* slots = (pipeline_slot*)realloc(compiler->slots,
+                capacity * sizeof(pipeline_slot));
+
+        if(slots == NULL) {
+            pthread_mutex_unlock(&compiler->lock);
+
+            vkDestroyShaderModule(compiler->device, desc->frag_module, NULL);
+            vkDestroyShaderModule(compiler->device, desc->vert_module, NULL);
+            return PIPELINE_HANDLE_NONE;
+        }
+
+        memset(slots + compiler->slot_count, 0,
+            (capacity - compiler->slot_count) * sizeof(pipeline_slot));
+        compiler->slots = slots;
+        compiler->slot_count = capacity;
+    }
+
+    pipeline_slot* slot = &compiler->slots[index];
+    memset(slot, 0, sizeof(pipeline_slot));
+    slot->desc = *desc;
+    slot->status = PIPELINE_PENDING;
+    slot->in_use = true;
+    slot->next = PIPELINE_HANDLE_NONE;
+
+    if(compiler->thread_count == 0) {
+        pthread_mutex_unlock(&compiler->lock);
+
+        // Nobody else touches slots without threads
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        bool built = build_graphics_pipeline(compiler->device, compiler->cache,
+            desc, &pipeline);
+
+        vkDestroyShaderModule(compiler->device, desc->frag_module, NULL);
+        vkDestroyShaderModule(compiler->device, desc->vert_module, NULL);
+
+        finish_slot_(compiler, index, built, pipeline);
+        return index;
+    }
+
+    if(compiler->queue_tail == PIPELINE_HANDLE_NONE) {
+        compiler->queue_head = index;
+    }
+    else {
+        compiler->slots[compiler->queue_tail].next = index;
+    }
+    compiler->queue_tail = index;
+
+    pthread_cond_signal(&compiler->work_ready);
+    pthread_mutex_unlock(&compiler->lock);
+
+    return index;
+}
+
+pipeline_status pipeline_compiler_status(pipeline_compiler* compiler,
+        pipeline_handle handle) {
+    if(handle == PIPELINE_HANDLE_NONE) {
+        return PIPELINE_FAILED;
+    }
+
+    pthread_mutex_lock(&compiler->lock);
+    pipeline_status status = compiler->slots[handle].status;
+    pthread_mutex_unlock(&compiler->lock);
+
+    return status;
+}
+
+VkPipeline pipeline_compiler_get(pipeline_compiler* compiler,
+        pipeline_handle handle) {
+    if(handle == PIPELINE_HANDLE_NONE) {
+        return VK_NULL_HANDLE;
+    }
+
+    pthread_mutex_lock(&compiler->lock);
+
+    const pipeline_slot* slot = &compiler->slots[handle];
+    VkPipeline pipeline = slot->status == PIPELINE_READY ?
+        slot->pipeline : VK_NULL_HANDLE;
+
+    pthread_mutex_unlock(&compiler->lock);
+
+    return pipeline;
+}
+
+void pipeline_compiler_release(pipeline_compiler* compiler,
+        pipeline_handle handle) {
+    if(handle == PIPELINE_HANDLE_NONE) {
+        return;
+    }
+
+    pthread_mutex_lock(&compiler->lock);
+
+    pipeline_slot* slot = &compiler->slots[handle];
+    if(slot->status == PIPELINE_PENDING) {
+        slot->released = true;
+    }
+    else {
+        vkDestroyPipeline(compiler->device, slot->pipeline, NULL);
+        memset(slot, 0, sizeof(pipeline_slot));
+    }
+
+    pthread_mutex_unlock(&compiler->lock);
+}
+
+void pipeline_compiler_wait_idle(pipeline_compiler* compiler) {
+    pthread_mutex_lock(&compiler->lock);
+
+    while(compiler->queue_head != PIPELINE_HANDLE_NONE || compiler->compiling > 0) {
+        pthread_cond_wait(&compiler->work_done, &compiler->lock);
+    }
+
+    pthread_mutex_unlock(&compiler->lock);
+}
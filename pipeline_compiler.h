@@ -0,0 +1,178 @@
+#ifndef PIPELINE_COMPILER_H
+#define PIPELINE_COMPILER_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dynamic_state.h"
+
+#define MAX_VERTEX_BINDINGS 2
+#define MAX_VERTEX_ATTRIBUTES 8
+
+// Returned for failed submissions and used as "no fallback"
+#define PIPELINE_HANDLE_NONE UINT32_MAX
+
+typedef uint32_t pipeline_handle;
+
+typedef enum {
+    PIPELINE_PENDING = 0,
+    PIPELINE_READY,
+    PIPELINE_FAILED
+} pipeline_status;
+
+/**
+ * Everything needed to build a graphics pipeline, by value so it can
+ * outlive the caller's stack. The pipeline targets render_pass when
+ * it is set and a single color_format attachment under dynamic
+ * rendering otherwise.
+ */
+typedef struct {
+    VkShaderModule vert_module;
+    VkShaderModule frag_module;
+    VkPipelineLayout layout;
+
+    // Shaders pulling their vertices from buffers have no bindings
+    VkVertexInputBindingDescription bindings[MAX_VERTEX_BINDINGS];
+    uint32_t binding_count;
+    VkVertexInputAttributeDescription attributes[MAX_VERTEX_ATTRIBUTES];
+    uint32_t attribute_count;
+
+    // Only the tier flags of dynamic_state are used
+    draw_state state;
+    dynamic_state_table dynamic_state;
+
+    VkRenderPass render_pass;
+    VkFormat color_format;
+} graphics_pipeline_desc;
+
+/**
+ * A submitted pipeline. Slots are reused once released.
+ */
+typedef struct {
+    graphics_pipeline_desc desc;
+    VkPipeline pipeline;
+    pipeline_status status;
+
+    bool in_use;
+    // Released while still compiling, destroyed once it finishes
+    bool released;
+    // Next slot in the pending queue
+    uint32_t next;
+} pipeline_slot;
+
+/**
+ * Compiles graphics pipelines on background threads against a
+ * shared pipeline cache. Submitting returns a handle right away and
+ * the pipeline can be polled from the render loop, so startup
+ * doesn't wait on every variant being compiled.
+ *
+ * All functions are called from the main thread.
+ */
+typedef struct {
+    VkDevice device;
+    VkPipelineCache cache;
+
+    pthread_t* threads;
+    uint32_t thread_count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    bool shutdown;
+
+    // Compiles running right now, signalled through work_done
+    uint32_t compiling;
+    pthread_cond_t work_done;
+
+    pipeline_slot* slots;
+    uint32_t slot_count;
+
+    // FIFO of pending slots linked through pipeline_slot.next
+    uint32_t queue_head;
+    uint32_t queue_tail;
+} pipeline_compiler;
+
+/**
+ * Builds a graphics pipeline on the calling thread.
+ *
+ * Params:
+ *   device - logical device
+ *   cache  - pipeline cache, or VK_NULL_HANDLE
+ *   desc   - pipeline to build
+ *   out    - receives the pipeline
+ *
+ * Returns:
+ *   bool indicating success
+ */
+bool build_graphics_pipeline(VkDevice device, VkPipelineCache cache,
+        const graphics_pipeline_desc* desc, VkPipeline* out);
+
+/**
+ * Starts the compile threads. With zero threads pipelines are built
+ * synchronously when submitted.
+ *
+ * Params:
+ *   compiler     - compiler to initialize
+ *   device       - logical device
+ *   cache        - pipeline cache shared by all threads
+ *   thread_count - number of compile threads
+ *
+ * Returns:
+ *   bool indicating success
+ */
+bool init_pipeline_compiler(pipeline_compiler* compiler, VkDevice device,
+        VkPipelineCache cache, uint32_t thread_count);
+
+/**
+ * Stops the compile threads, dropping anything still queued, and
+ * destroys every pipeline. The device must be idle.
+ */
+void cleanup_pipeline_compiler(pipeline_compiler* compiler);
+
+/**
+ * Queues a pipeline for compilation. The compiler takes ownership
+ * of the shader modules in desc and destroys them once the pipeline
+ * is built, even when submission fails.
+ *
+ * Params:
+ *   compiler - pipeline compiler
+ *   desc     - pipeline to build
+ *
+ * Returns:
+ *   handle of the pipeline, or PIPELINE_HANDLE_NONE on failure
+ */
+pipeline_handle pipeline_compiler_submit(pipeline_compiler* compiler,
+        const graphics_pipeline_desc* desc);
+
+/**
+ * Returns the compile status of a pipeline. PIPELINE_HANDLE_NONE
+ * reports as failed.
+ */
+pipeline_status pipeline_compiler_status(pipeline_compiler* compiler,
+        pipeline_handle handle);
+
+/**
+ * Returns the pipeline if it is ready, or VK_NULL_HANDLE if the draw
+ * should be skipped. Never blocks.
+ */
+VkPipeline pipeline_compiler_get(pipeline_compiler* compiler,
+        pipeline_handle handle);
+
+/**
+ * Destroys a pipeline, or arranges for it to be destroyed when its
+ * compile finishes. The GPU must be done with it.
+ */
+void pipeline_compiler_release(pipeline_compiler* compiler,
+        pipeline_handle handle);
+
+/**
+ * Blocks until every queued and running compile has finished. Needed
+ * before destroying a render pass or layout a submitted pipeline was
+ * described with.
+ */
+void pipeline_compiler_wait_idle(pipeline_compiler* compiler);
+
+#endif
@@ -0,0 +1,226 @@
+#include "record_workers.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Records this worker's share of the current job into its
+ * secondary command buffer for the job's frame.
+ * 
+ * Params:
+ *   worker - worker doing the recording
+ */
+static void record_share_(record_worker* worker) {
+    record_workers* workers = worker->owner;
+
+    // Spread the remainder over the first few workers
+    uint32_t per_worker = workers->draw_count / workers->worker_count;
+    uint32_t remainder = workers->draw_count % workers->worker_count;
+
+    uint32_t first = worker->index * per_worker +
+        (worker->index < remainder ? worker->index : remainder);
+    uint32_t count = per_worker + (worker->index < remainder ? 1 : 0);
+
+    worker->has_work = count > 0;
+    worker->failed = false;
+
+    if(!worker->has_work) {
+        return;
+    }
+
+    VkCommandBuffer cmd = worker->buffers[workers->frame];
+    vkResetCommandPool(workers->device, worker->pools[workers->frame], 0);
+
+    VkCommandBufferBeginInfo beg_info = {};
+    beg_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beg_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+        VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beg_info.pInheritanceInfo = &workers->inheritance;
+
+    if(vkBeginCommandBuffer(cmd, &beg_info) != VK_SUCCESS) {
+        worker->failed = true;
+        return;
+    }
+
+    workers->record(workers->user, cmd, first, count);
+
+    worker->failed = vkEndCommandBuffer(cmd) != VK_SUCCESS;
+}
+
+/**
+ * Worker thread entry point. Sleeps until a new job generation is
+ * published, records its share and reports back.
+ */
+static void* worker_main_(void* arg) {
+    record_worker* worker = (record_worker*)arg;
+    record_workers* workers = worker->owner;
+    uint64_t seen_generation = 0;
+
+    pthread_mutex_lock(&workers->lock);
+    while(true) {
+        while(!workers->shutdown && workers->generation == seen_generation) {
+            pthread_cond_wait(&workers->work_ready, &workers->lock);
+        }
+
+        if(workers->shutdown) {
+            break;
+        }
+
+        seen_generation = workers->generation;
+        pthread_mutex_unlock(&workers->lock);
+
+        record_share_(worker);
+
+        pthread_mutex_lock(&workers->lock);
+        workers->pending--;
+        if(workers->pending == 0) {
+            pthread_cond_signal(&workers->work_done);
+        }
+    }
+    pthread_mutex_unlock(&workers->lock);
+
+    return NULL;
+}
+
+bool init_record_workers(record_workers* workers, VkDevice device,
+        uint32_t queue_family, uint32_t worker_count, uint32_t frame_count) {
+    workers->device = device;
+    workers->worker_count = 0;
+    workers->frame_count = frame_count;
+    workers->generation = 0;
+    workers->pending = 0;
+    workers->shutdown = false;
+
+    pthread_mutex_init(&workers->lock, NULL);
+    pthread_cond_init(&workers->work_ready, NULL);
+    pthread_cond_init(&workers->work_done, NULL);
+
+    workers->workers = (record_worker*)calloc(worker_count, sizeof(record_worker));
+
+    VkCommandPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.queueFamilyIndex = queue_family;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    bool success = true;
+    for(uint32_t i = 0; i < worker_count && success; i++) {
+        record_worker* worker = &workers->workers[i];
+        worker->index = i;
+        worker->owner = workers;
+        worker->pools = (VkCommandPool*)calloc(frame_count, sizeof(VkCommandPool));
+        worker->buffers = (VkCommandBuffer*)calloc(frame_count, sizeof(VkCommandBuffer));
+
+        // Count the worker now so cleanup sees its pools even on failure
+        workers->worker_count++;
+
+        for(uint32_t f = 0; f < frame_count && success; f++) {
+            success = vkCreateCommandPool(device, &pool_info, NULL,
+                    &worker->pools[f]) == VK_SUCCESS;
+
+            if(success) {
+                VkCommandBufferAllocateInfo buf_info = {};
+                buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                buf_info.commandPool = worker->pools[f];
+                buf_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+                buf_info.commandBufferCount = 1;
+
+                success = vkAllocateCommandBuffers(device, &buf_info,
+                        &worker->buffers[f]) == VK_SUCCESS;
+            }
+        }
+    }
+
+    // Threads are only started once every pool exists
+    for(uint32_t i = 0; i < workers->worker_count && success; i++) {
+        success = pthread_create(&workers->workers[i].thread, NULL,
+                worker_main_, &workers->workers[i]) == 0;
+
+        workers->workers[i].running = success;
+    }
+
+    if(!success) {
+        cleanup_record_workers(workers);
+        workers->worker_count = 0;
+
+        fprintf(stderr, "Unable to start %i recording workers\n", worker_count);
+    }
+    else {
+        printf("Started %i command recording workers\n", workers->worker_count);
+    }
+
+    return success;
+}
+
+void cleanup_record_workers(record_workers* workers) {
+    if(workers->workers == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&workers->lock);
+    workers->shutdown = true;
+    pthread_cond_broadcast(&workers->work_ready);
+    pthread_mutex_unlock(&workers->lock);
+
+    for(uint32_t i = 0; i < workers->worker_count; i++) {
+        if(workers->workers[i].running) {
+            pthread_join(workers->workers[i].thread, NULL);
+        }
+    }
+
+    // Pools may exist for workers whose thread never started
+    for(uint32_t i = 0; i < workers->worker_count; i++) {
+        record_worker* worker = &workers->workers[i];
+
+        for(uint32_t f = 0; f < workers->frame_count; f++) {
+            vkDestroyCommandPool(workers->device, worker->pools[f], NULL);
+        }
+        free(worker->pools);
+        free(worker->buffers);
+    }
+
+    free(workers->workers);
+    workers->workers = NULL;
+
+    pthread_cond_destroy(&workers->work_done);
+    pthread_cond_destroy(&workers->work_ready);
+    pthread_mutex_destroy(&workers->lock);
+}
+
+uint32_t record_workers_dispatch(record_workers* workers, uint32_t frame,
+        const VkCommandBufferInheritanceInfo* inheritance, uint32_t draw_count,
+        record_draws_fn record, void* user, VkCommandBuffer* out) {
+    pthread_mutex_lock(&workers->lock);
+
+    workers->frame = frame;
+    workers->inheritance = *inheritance;
+    workers->draw_count = draw_count;
+    workers->record = record;
+    workers->user = user;
+
+    workers->pending = workers->worker_count;
+    workers->generation++;
+    pthread_cond_broadcast(&workers->work_ready);
+
+    while(workers->pending > 0) {
+        pthread_cond_wait(&workers->work_done, &workers->lock);
+    }
+
+    pthread_mutex_unlock(&workers->lock);
+
+    // Keep submission order stable so draws execute in order
+    uint32_t buffer_count = 0;
+    for(uint32_t i = 0; i < workers->worker_count; i++) {
+        record_worker* worker = &workers->workers[i];
+
+        if(worker->failed) {
+            fprintf(stderr, "Recording worker %i failed\n", i);
+            return 0;
+        }
+
+        if(worker->has_work) {
+            out[buffer_count++] = worker->buffers[frame];
+        }
+    }
+
+    return buffer_count;
+}
@@ -0,0 +1,112 @@
+#ifndef RECORD_WORKERS_H
+#define RECORD_WORKERS_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Callback used by workers to record a range of draws into a
+ * secondary command buffer. Called from worker threads, so it must
+ * only touch state that is read-only while a dispatch is running.
+ */
+typedef void (*record_draws_fn)(void* user, VkCommandBuffer cmd,
+        uint32_t first_draw, uint32_t draw_count);
+
+struct record_workers;
+
+/**
+ * A single recording thread. Owns one command pool and one
+ * secondary command buffer per frame in flight so it never has to
+ * synchronize with other threads while recording.
+ */
+typedef struct {
+    pthread_t thread;
+    bool running;
+    uint32_t index;
+
+    VkCommandPool* pools;
+    VkCommandBuffer* buffers;
+
+    // Set for the current dispatch
+    bool has_work;
+    bool failed;
+
+    struct record_workers* owner;
+} record_worker;
+
+/**
+ * Pool of threads that record secondary command buffers in
+ * parallel. The main thread hands out one job per frame with
+ * record_workers_dispatch and blocks until every worker is done.
+ */
+typedef struct record_workers {
+    VkDevice device;
+
+    record_worker* workers;
+    uint32_t worker_count;
+    uint32_t frame_count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    uint64_t generation;
+    uint32_t pending;
+    bool shutdown;
+
+    // Current job, read-only for workers while pending != 0
+    uint32_t frame;
+    VkCommandBufferInheritanceInfo inheritance;
+    uint32_t draw_count;
+    record_draws_fn record;
+    void* user;
+} record_workers;
+
+/**
+ * Starts the worker threads and creates their per-frame command
+ * pools.
+ * 
+ * Params:
+ *   workers      - worker pool to initialize
+ *   device       - logical device
+ *   queue_family - family the recorded buffers will be submitted to
+ *   worker_count - number of threads to start
+ *   frame_count  - number of frames in flight
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool init_record_workers(record_workers* workers, VkDevice device,
+        uint32_t queue_family, uint32_t worker_count, uint32_t frame_count);
+
+/**
+ * Stops the worker threads and destroys their command pools. The
+ * device must be idle.
+ */
+void cleanup_record_workers(record_workers* workers);
+
+/**
+ * Splits draw_count draws across the workers, each of which resets
+ * its pool for the given frame and records its share into a
+ * secondary command buffer. Blocks until all workers have finished.
+ * 
+ * Params:
+ *   workers     - worker pool
+ *   frame       - frame in flight index, it must have retired
+ *   inheritance - render pass state the secondaries execute within
+ *   draw_count  - total number of draws to record
+ *   record      - callback that records a range of draws
+ *   user        - passed through to the callback
+ *   out         - receives the recorded buffers, must hold worker_count
+ * 
+ * Returns:
+ *   number of buffers written to out, or 0 on failure
+ */
+uint32_t record_workers_dispatch(record_workers* workers, uint32_t frame,
+        const VkCommandBufferInheritanceInfo* inheritance, uint32_t draw_count,
+        record_draws_fn record, void* user, VkCommandBuffer* out);
+
+#endif
@@ -0,0 +1,217 @@
+#include "shader_watcher.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <spawn.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+// Stages a changed file has to end in to be compiled
+static const char* SHADER_EXTENSIONS[] = {
+    ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese"
+};
+static const uint32_t SHADER_EXTENSION_COUNT = 6;
+
+/**
+ * Checks if a file name looks like a shader source. Editor swap and
+ * backup files don't.
+ */
+static bool is_shader_source_(const char* name) {
+    size_t length = strlen(name);
+    if(name[0] == '.' || length >= SHADER_NAME_MAX) {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < SHADER_EXTENSION_COUNT; i++) {
+        size_t ext_length = strlen(SHADER_EXTENSIONS[i]);
+
+        if(length > ext_length &&
+                strcmp(name + length - ext_length, SHADER_EXTENSIONS[i]) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool shader_watcher_has_compiled(const shader_watcher* watcher,
+        const char* name) {
+    for(uint32_t i = 0; i < watcher->compiled_count; i++) {
+        if(strcmp(watcher->compiled[i], name) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifdef __linux__
+
+bool init_shader_watcher(shader_watcher* watcher, const char* source_dir,
+        const char* output_dir, const char* compiler, bool glslang) {
+    memset(watcher, 0, sizeof(shader_watcher));
+    watcher->fd = -1;
+    watcher->watch = -1;
+
+    snprintf(watcher->source_dir, SHADER_PATH_MAX, "%s", source_dir);
+    snprintf(watcher->output_dir, SHADER_PATH_MAX, "%s", output_dir);
+    snprintf(watcher->compiler, SHADER_PATH_MAX, "%s", compiler);
+    watcher->glslang = glslang;
+
+    if(mkdir(output_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Unable to create shader output directory %s\n", output_dir);
+        return false;
+    }
+
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(watcher->fd < 0) {
+        fprintf(stderr, "Unable to initialize inotify\n");
+        return false;
+    }
+
+    // Editors either rewrite the file in place or move a new one over it
+    watcher->watch = inotify_add_watch(watcher->fd, source_dir,
+        IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(watcher->watch < 0) {
+        fprintf(stderr, "Unable to watch %s\n", source_dir);
+        cleanup_shader_watcher(watcher);
+        return false;
+    }
+
+    printf("Watching %s for shader changes\n", source_dir);
+    return true;
+}
+
+void cleanup_shader_watcher(shader_watcher* watcher) {
+    if(watcher->fd >= 0) {
+        close(watcher->fd);
+    }
+
+    watcher->fd = -1;
+    watcher->watch = -1;
+}
+
+uint32_t poll_shader_watcher(shader_watcher* watcher,
+        char names[][SHADER_NAME_MAX], uint32_t max_names) {
+    if(watcher->fd < 0) {
+        return 0;
+    }
+
+    // Large enough for a burst of events, and aligned as inotify wants
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    uint32_t count = 0;
+
+    while(true) {
+        ssize_t length = read(watcher->fd, buffer, sizeof(buffer));
+        if(length <= 0) {
+            break;
+        }
+
+        for(char* ptr = buffer; ptr < buffer + length; ) {
+            const struct inotify_event* event = (const struct inotify_event*)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if(event->len == 0 || !is_shader_source_(event->name)) {
+                continue;
+            }
+
+            bool seen = false;
+            for(uint32_t i = 0; i < count && !seen; i++) {
+                seen = strcmp(names[i], event->name) == 0;
+            }
+
+            if(!seen && count < max_names) {
+                snprintf(names[count++], SHADER_NAME_MAX, "%s", event->name);
+            }
+        }
+    }
+
+    return count;
+}
+
+bool compile_watched_shader(shader_watcher* watcher, const char* name) {
+    // Room for a directory, a separator, a name and ".spv"
+    char source[SHADER_PATH_MAX + SHADER_NAME_MAX + 8];
+    char output[SHADER_PATH_MAX + SHADER_NAME_MAX + 8];
+    int source_length = snprintf(source, sizeof(source), "%s/%s",
+        watcher->source_dir, name);
+    int output_length = snprintf(output, sizeof(output), "%s/%s.spv",
+        watcher->output_dir, name);
+
+    // A truncated path would compile or write the wrong file
+    if(source_length < 0 || (size_t)source_length >= sizeof(source) ||
+            output_length < 0 || (size_t)output_length >= sizeof(output)) {
+        fprintf(stderr, "Shader path for %s is too long\n", name);
+        return false;
+    }
+
+    // Same invocation the build uses
+    char* argv[6];
+    uint32_t argc = 0;
+    argv[argc++] = watcher->compiler;
+    if(watcher->glslang) {
+        argv[argc++] = "-V";
+    }
+    argv[argc++] = "-o";
+    argv[argc++] = output;
+    argv[argc++] = source;
+    argv[argc] = NULL;
+
+    pid_t pid;
+    if(posix_spawnp(&pid, watcher->compiler, NULL, NULL, argv, environ) != 0) {
+        fprintf(stderr, "Unable to run %s\n", watcher->compiler);
+        return false;
+    }
+
+    int status = 0;
+    while(waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Failed to compile %s\n", name);
+        return false;
+    }
+
+    if(!shader_watcher_has_compiled(watcher, name) &&
+            watcher->compiled_count < SHADER_WATCHER_MAX_SHADERS) {
+        snprintf(watcher->compiled[watcher->compiled_count++], SHADER_NAME_MAX,
+            "%s", name);
+    }
+
+    printf("Recompiled %s\n", name);
+    return true;
+}
+
+#else
+
+bool init_shader_watcher(shader_watcher* watcher, const char* source_dir,
+        const char* output_dir, const char* compiler, bool glslang) {
+    memset(watcher, 0, sizeof(shader_watcher));
+    watcher->fd = -1;
+    watcher->watch = -1;
+
+    fprintf(stderr, "Shader hot reload is only supported on Linux\n");
+    return false;
+}
+
+void cleanup_shader_watcher(shader_watcher* watcher) {
+}
+
+uint32_t poll_shader_watcher(shader_watcher* watcher,
+        char names[][SHADER_NAME_MAX], uint32_t max_names) {
+    return 0;
+}
+
+bool compile_watched_shader(shader_watcher* watcher, const char* name) {
+    return false;
+}
+
+#endif
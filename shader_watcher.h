@@ -0,0 +1,89 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SHADER_NAME_MAX 64
+#define SHADER_PATH_MAX 1024
+
+// Distinct shaders that can be recompiled in one run
+#define SHADER_WATCHER_MAX_SHADERS 32
+
+/**
+ * Watches a directory of GLSL sources and recompiles changed files
+ * to SPIR-V with an external compiler. Built on inotify, so it only
+ * works on Linux; elsewhere init_shader_watcher fails.
+ */
+typedef struct {
+    int fd;
+    int watch;
+
+    char source_dir[SHADER_PATH_MAX];
+    char output_dir[SHADER_PATH_MAX];
+
+    // glslc, or glslangValidator when glslang is set
+    char compiler[SHADER_PATH_MAX];
+    bool glslang;
+
+    // Shaders successfully recompiled since startup. Their newest
+    // SPIR-V is in output_dir.
+    char compiled[SHADER_WATCHER_MAX_SHADERS][SHADER_NAME_MAX];
+    uint32_t compiled_count;
+} shader_watcher;
+
+/**
+ * Starts watching source_dir and creates output_dir if needed.
+ *
+ * Params:
+ *   watcher    - watcher to initialize
+ *   source_dir - directory holding the GLSL sources
+ *   output_dir - directory recompiled SPIR-V is written to
+ *   compiler   - path of glslc or glslangValidator
+ *   glslang    - whether compiler is glslangValidator
+ *
+ * Returns:
+ *   bool indicating success
+ */
+bool init_shader_watcher(shader_watcher* watcher, const char* source_dir,
+        const char* output_dir, const char* compiler, bool glslang);
+
+/**
+ * Stops watching. Safe to call on a watcher that failed to start.
+ */
+void cleanup_shader_watcher(shader_watcher* watcher);
+
+/**
+ * Collects the shader sources written since the last poll without
+ * blocking. Each name is reported once per poll however many times
+ * it was written.
+ *
+ * Params:
+ *   watcher   - shader watcher
+ *   names     - receives the file names, e.g. "shader.vert"
+ *   max_names - capacity of names
+ *
+ * Returns:
+ *   number of names written
+ */
+uint32_t poll_shader_watcher(shader_watcher* watcher,
+        char names[][SHADER_NAME_MAX], uint32_t max_names);
+
+/**
+ * Compiles a source from source_dir into <output_dir>/<name>.spv.
+ * Blocks until the compiler exits. Compiler errors are left on
+ * stderr.
+ *
+ * Returns:
+ *   bool indicating success
+ */
+bool compile_watched_shader(shader_watcher* watcher, const char* name);
+
+/**
+ * Whether a shader has been recompiled since startup, meaning
+ * output_dir holds a newer version than the embedded one.
+ */
+bool shader_watcher_has_compiled(const shader_watcher* watcher,
+        const char* name);
+
+#endif
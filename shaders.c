@@ -0,0 +1,56 @@
+#include "shaders.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool load_shader_code_from(const char* dir, const char* name, shader_code* out) {
+    memset(out, 0, sizeof(shader_code));
+
+    char path[1024];
+    int length = snprintf(path, sizeof(path), "%s/%s.spv", dir, name);
+
+    // Never load whatever a truncated path happens to name
+    if(length < 0 || (size_t)length >= sizeof(path)) {
+        fprintf(stderr, "Shader path for %s is too long\n", name);
+        return false;
+    }
+
+    if(!map_spirv_file(path, &out->mapping)) {
+        return false;
+    }
+
+    out->code = (const uint32_t*)out->mapping.data;
+    out->size = out->mapping.size;
+    return true;
+}
+
+bool load_shader_code(const char* name, shader_code* out) {
+    memset(out, 0, sizeof(shader_code));
+
+    const char* dir = getenv(SHADER_DIR_ENV);
+    if(dir != NULL && dir[0] != '\0') {
+        if(load_shader_code_from(dir, name, out)) {
+            return true;
+        }
+
+        fprintf(stderr, "Falling back to embedded %s\n", name);
+    }
+
+    for(uint32_t i = 0; i < EMBEDDED_SHADER_COUNT; i++) {
+        if(strcmp(EMBEDDED_SHADERS[i].name, name) == 0) {
+            out->code = EMBEDDED_SHADERS[i].code;
+            out->size = EMBEDDED_SHADERS[i].size;
+            return true;
+        }
+    }
+
+    fprintf(stderr, "No shader named \"%s\"\n", name);
+    return false;
+}
+
+void release_shader_code(shader_code* code) {
+    unmap_file(&code->mapping);
+    code->code = NULL;
+    code->size = 0;
+}
@@ -0,0 +1,72 @@
+#ifndef SHADERS_H
+#define SHADERS_H
+
+#include "utils.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// When set, shaders are loaded from <dir>/<name>.spv instead of the
+// copies embedded at build time
+#define SHADER_DIR_ENV "LEARNVK_SHADER_DIR"
+
+/**
+ * A SPIR-V module compiled and embedded into the executable by the
+ * build. Defined in the generated shaders_embedded.c.
+ */
+typedef struct {
+    const char* name;
+    const uint32_t* code;
+    size_t size;
+} embedded_shader;
+
+extern const embedded_shader EMBEDDED_SHADERS[];
+extern const uint32_t EMBEDDED_SHADER_COUNT;
+
+/**
+ * SPIR-V code ready to be handed to vkCreateShaderModule. Either
+ * points into the executable or into a mapped override file.
+ */
+typedef struct {
+    const uint32_t* code;
+    size_t size;
+
+    mapped_file mapping;
+} shader_code;
+
+/**
+ * Looks up the SPIR-V for a shader by its source name, e.g.
+ * "shader.vert". The override directory is checked first if
+ * SHADER_DIR_ENV is set, so shaders can be iterated on without
+ * rebuilding.
+ * 
+ * Params:
+ *   name - file name of the shader source
+ *   out  - receives the code
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool load_shader_code(const char* name, shader_code* out);
+
+/**
+ * Loads <dir>/<name>.spv, without falling back to the embedded
+ * copy.
+ * 
+ * Params:
+ *   dir  - directory holding the compiled shader
+ *   name - file name of the shader source
+ *   out  - receives the code
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool load_shader_code_from(const char* dir, const char* name, shader_code* out);
+
+/**
+ * Releases code returned by load_shader_code.
+ */
+void release_shader_code(shader_code* code);
+
+#endif
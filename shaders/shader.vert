@@ -1,21 +1,48 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
 
-layout(location = 0) out vec3 fragColor;
+// The bindless table, see bindless.h
+layout(std430, set = 0, binding = 0) readonly buffer VertexBuffer {
+    float floats[];
+} buffers[];
+
+layout(push_constant) uniform DrawParams {
+    uint vertex_buffer;
+} draw;
+
+// Per-draw block from the uniform ring, see uniform_ring.h
+layout(std140, set = 1, binding = 0) uniform DrawUniforms {
+    vec2 offset;
+    float scale;
+} uniforms;
+
+// Per-instance attributes, laid out like instance_data in vk_app.h.
+// The transform is offset, scale and rotation in radians.
+layout(location = 0) in vec4 instanceTransform;
+layout(location = 1) in vec4 instanceColor;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+// Vertices are tightly packed floats, laid out like vertex in vk_app.h:
+// vec2 position followed by vec3 color
+const uint VERTEX_FLOATS = 5;
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+layout(location = 0) out vec3 fragColor;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
-}
\ No newline at end of file
+    uint first = uint(gl_VertexIndex) * VERTEX_FLOATS;
+
+    // Same index for the whole draw, no nonuniformEXT needed
+    vec2 pos = vec2(buffers[draw.vertex_buffer].floats[first],
+        buffers[draw.vertex_buffer].floats[first + 1]);
+    vec3 color = vec3(buffers[draw.vertex_buffer].floats[first + 2],
+        buffers[draw.vertex_buffer].floats[first + 3],
+        buffers[draw.vertex_buffer].floats[first + 4]);
+
+    // Instance transform first, then the draw's grid cell
+    float s = sin(instanceTransform.w);
+    float c = cos(instanceTransform.w);
+    vec2 local = mat2(c, s, -s, c) * pos * instanceTransform.z + instanceTransform.xy;
+
+    gl_Position = vec4(local * uniforms.scale + uniforms.offset, 0.0, 1.0);
+    fragColor = color * instanceColor.rgb;
+}
@@ -0,0 +1,642 @@
+#include "spirv_reflect.h"
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The handful of SPIR-V opcodes, decorations and enums reflection
+// needs, from the SPIR-V specification
+enum {
+    SPV_OP_ENTRY_POINT = 15,
+    SPV_OP_TYPE_VOID = 19,
+    SPV_OP_TYPE_BOOL = 20,
+    SPV_OP_TYPE_INT = 21,
+    SPV_OP_TYPE_FLOAT = 22,
+    SPV_OP_TYPE_VECTOR = 23,
+    SPV_OP_TYPE_MATRIX = 24,
+    SPV_OP_TYPE_IMAGE = 25,
+    SPV_OP_TYPE_SAMPLER = 26,
+    SPV_OP_TYPE_SAMPLED_IMAGE = 27,
+    SPV_OP_TYPE_ARRAY = 28,
+    SPV_OP_TYPE_RUNTIME_ARRAY = 29,
+    SPV_OP_TYPE_STRUCT = 30,
+    SPV_OP_TYPE_POINTER = 32,
+    SPV_OP_CONSTANT = 43,
+    SPV_OP_SPEC_CONSTANT_TRUE = 48,
+    SPV_OP_SPEC_CONSTANT_FALSE = 49,
+    SPV_OP_SPEC_CONSTANT = 50,
+    SPV_OP_VARIABLE = 59,
+    SPV_OP_DECORATE = 71,
+    SPV_OP_MEMBER_DECORATE = 72
+};
+
+enum {
+    SPV_DECORATION_SPEC_ID = 1,
+    SPV_DECORATION_BLOCK = 2,
+    SPV_DECORATION_BUFFER_BLOCK = 3,
+    SPV_DECORATION_ARRAY_STRIDE = 6,
+    SPV_DECORATION_MATRIX_STRIDE = 7,
+    SPV_DECORATION_BUILT_IN = 11,
+    SPV_DECORATION_LOCATION = 30,
+    SPV_DECORATION_BINDING = 33,
+    SPV_DECORATION_DESCRIPTOR_SET = 34,
+    SPV_DECORATION_OFFSET = 35
+};
+
+enum {
+    SPV_STORAGE_UNIFORM_CONSTANT = 0,
+    SPV_STORAGE_INPUT = 1,
+    SPV_STORAGE_UNIFORM = 2,
+    SPV_STORAGE_PUSH_CONSTANT = 9,
+    SPV_STORAGE_STORAGE_BUFFER = 12
+};
+
+enum {
+    SPV_DIM_BUFFER = 5,
+    SPV_DIM_SUBPASS_DATA = 6
+};
+
+// Decorations seen on an id
+#define ID_HAS_SET (1u << 0)
+#define ID_HAS_BINDING (1u << 1)
+#define ID_HAS_LOCATION (1u << 2)
+#define ID_HAS_SPEC_ID (1u << 3)
+#define ID_BUILT_IN (1u << 4)
+#define ID_BLOCK (1u << 5)
+#define ID_BUFFER_BLOCK (1u << 6)
+
+/**
+ * What reflection knows about a single result id: the instruction
+ * defining it and the decorations applied to it.
+ */
+typedef struct {
+    uint32_t opcode;
+    uint32_t offset;
+
+    uint32_t flags;
+    uint32_t set;
+    uint32_t binding;
+    uint32_t location;
+    uint32_t spec_id;
+    uint32_t array_stride;
+} spirv_id_;
+
+/**
+ * A parsed module. ids is indexed by result id.
+ */
+typedef struct {
+    const uint32_t* code;
+    uint32_t word_count;
+
+    spirv_id_* ids;
+    uint32_t id_bound;
+} spirv_module_;
+
+static uint32_t type_size_(const spirv_module_* module, uint32_t type);
+
+/**
+ * Returns the defining instruction of an id, or NULL if the id is
+ * out of range or was never defined.
+ */
+static const uint32_t* id_instruction_(const spirv_module_* module, uint32_t id) {
+    if(id >= module->id_bound || module->ids[id].opcode == 0) {
+        return NULL;
+    }
+
+    return module->code + module->ids[id].offset;
+}
+
+/**
+ * Looks up a decoration of a struct member.
+ *
+ * Returns:
+ *   bool indicating whether the member has the decoration
+ */
+static bool member_decoration_(const spirv_module_* module, uint32_t type,
+        uint32_t member, uint32_t decoration, uint32_t* value) {
+    uint32_t i = 5;
+    while(i < module->word_count) {
+        uint32_t length = module->code[i] >> 16;
+        uint32_t opcode = module->code[i] & 0xFFFF;
+
+        if(opcode == SPV_OP_MEMBER_DECORATE && length >= 5 &&
+                module->code[i + 1] == type &&
+                module->code[i + 2] == member &&
+                module->code[i + 3] == decoration) {
+            *value = module->code[i + 4];
+            return true;
+        }
+
+        i += length;
+    }
+
+    return false;
+}
+
+/**
+ * Returns the offset one past the last byte of a struct, laid out
+ * by its member Offset decorations.
+ */
+static uint32_t struct_end_(const spirv_module_* module, uint32_t type) {
+    const uint32_t* inst = id_instruction_(module, type);
+    uint32_t member_count = (inst[0] >> 16) - 2;
+    uint32_t end = 0;
+
+    for(uint32_t m = 0; m < member_count; m++) {
+        uint32_t member_type = inst[2 + m];
+        uint32_t offset = 0;
+        member_decoration_(module, type, m, SPV_DECORATION_OFFSET, &offset);
+
+        // Matrix columns are padded out to their stride
+        uint32_t size = type_size_(module, member_type);
+        uint32_t stride = 0;
+        const uint32_t* member_inst = id_instruction_(module, member_type);
+        if(member_inst != NULL && (member_inst[0] & 0xFFFF) == SPV_OP_TYPE_MATRIX &&
+                member_decoration_(module, type, m, SPV_DECORATION_MATRIX_STRIDE, &stride)) {
+            size = member_inst[3] * stride;
+        }
+
+        if(offset + size > end) {
+            end = offset + size;
+        }
+    }
+
+    return end;
+}
+
+/**
+ * Returns the value of an integer constant, or 0 if id isn't one.
+ */
+static uint32_t constant_value_(const spirv_module_* module, uint32_t id) {
+    const uint32_t* inst = id_instruction_(module, id);
+    if(inst == NULL) {
+        return 0;
+    }
+
+    uint32_t opcode = inst[0] & 0xFFFF;
+    if(opcode != SPV_OP_CONSTANT && opcode != SPV_OP_SPEC_CONSTANT) {
+        return 0;
+    }
+
+    return inst[3];
+}
+
+/**
+ * Returns the size of a type in bytes as laid out in a buffer.
+ * Runtime arrays have no size.
+ */
+static uint32_t type_size_(const spirv_module_* module, uint32_t type) {
+    const uint32_t* inst = id_instruction_(module, type);
+    if(inst == NULL) {
+        return 0;
+    }
+
+    switch(inst[0] & 0xFFFF) {
+        case SPV_OP_TYPE_BOOL:
+            return 4;
+        case SPV_OP_TYPE_INT:
+        case SPV_OP_TYPE_FLOAT:
+            return inst[2] / 8;
+        case SPV_OP_TYPE_VECTOR:
+        case SPV_OP_TYPE_MATRIX:
+            return inst[3] * type_size_(module, inst[2]);
+        case SPV_OP_TYPE_ARRAY: {
+            uint32_t stride = module->ids[type].array_stride;
+            if(stride == 0) {
+                stride = type_size_(module, inst[2]);
+            }
+            return constant_value_(module, inst[3]) * stride;
+        }
+        case SPV_OP_TYPE_STRUCT:
+            return struct_end_(module, type);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Returns the vertex attribute format matching a scalar or vector
+ * type, or VK_FORMAT_UNDEFINED for anything else.
+ */
+static VkFormat vertex_format_(const spirv_module_* module, uint32_t type) {
+    static const VkFormat FLOAT_FORMATS[4] = {
+        VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+        VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT
+    };
+    static const VkFormat SINT_FORMATS[4] = {
+        VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT,
+        VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT
+    };
+    static const VkFormat UINT_FORMATS[4] = {
+        VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT,
+        VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT
+    };
+
+    const uint32_t* inst = id_instruction_(module, type);
+    if(inst == NULL) {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    uint32_t components = 1;
+    if((inst[0] & 0xFFFF) == SPV_OP_TYPE_VECTOR) {
+        components = inst[3];
+        inst = id_instruction_(module, inst[2]);
+    }
+
+    if(inst == NULL || components < 1 || components > 4 || inst[2] != 32) {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    switch(inst[0] & 0xFFFF) {
+        case SPV_OP_TYPE_FLOAT:
+            return FLOAT_FORMATS[components - 1];
+        case SPV_OP_TYPE_INT:
+            return inst[3] ? SINT_FORMATS[components - 1] : UINT_FORMATS[components - 1];
+        default:
+            return VK_FORMAT_UNDEFINED;
+    }
+}
+
+/**
+ * Works out the descriptor type and count of a resource variable.
+ *
+ * Returns:
+ *   false if the variable isn't a descriptor reflection understands
+ */
+static bool descriptor_info_(const spirv_module_* module, uint32_t storage,
+        uint32_t type, VkDescriptorType* out_type, uint32_t* out_count) {
+    uint32_t count = 1;
+    const uint32_t* inst = id_instruction_(module, type);
+
+    // Arrays of descriptors, possibly runtime sized
+    while(inst != NULL) {
+        uint32_t opcode = inst[0] & 0xFFFF;
+
+        if(opcode == SPV_OP_TYPE_ARRAY) {
+            count *= constant_value_(module, inst[3]);
+        }
+        else if(opcode == SPV_OP_TYPE_RUNTIME_ARRAY) {
+            count = 0;
+        }
+        else {
+            break;
+        }
+
+        type = inst[2];
+        inst = id_instruction_(module, type);
+    }
+
+    if(inst == NULL) {
+        return false;
+    }
+
+    *out_count = count;
+
+    switch(inst[0] & 0xFFFF) {
+        case SPV_OP_TYPE_SAMPLER:
+            *out_type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            return true;
+        case SPV_OP_TYPE_SAMPLED_IMAGE:
+            *out_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            return true;
+        case SPV_OP_TYPE_IMAGE:
+            // Dim, then Sampled: 1 means used with a sampler, 2 means storage
+            if(inst[3] == SPV_DIM_BUFFER) {
+                *out_type = inst[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER :
+                    VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            }
+            else if(inst[3] == SPV_DIM_SUBPASS_DATA) {
+                *out_type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            }
+            else {
+                *out_type = inst[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE :
+                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+            return true;
+        case SPV_OP_TYPE_STRUCT:
+            // Older modules mark storage buffers as Uniform + BufferBlock
+            if(storage == SPV_STORAGE_STORAGE_BUFFER ||
+                    (module->ids[type].flags & ID_BUFFER_BLOCK) != 0) {
+                *out_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            }
+            else {
+                *out_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Indexes every result id and decoration of the module.
+ *
+ * Returns:
+ *   false if the module is malformed
+ */
+static bool parse_module_(spirv_module_* module, VkShaderStageFlagBits* stage) {
+    const uint32_t* code = module->code;
+    bool found_entry = false;
+
+    uint32_t i = 5;
+    while(i < module->word_count) {
+        uint32_t length = code[i] >> 16;
+        uint32_t opcode = code[i] & 0xFFFF;
+
+        if(length == 0 || i + length > module->word_count) {
+            return false;
+        }
+
+        // Where the result id of a defining instruction sits
+        uint32_t result = 0;
+        switch(opcode) {
+            case SPV_OP_TYPE_VOID:
+            case SPV_OP_TYPE_BOOL:
+            case SPV_OP_TYPE_INT:
+            case SPV_OP_TYPE_FLOAT:
+            case SPV_OP_TYPE_VECTOR:
+            case SPV_OP_TYPE_MATRIX:
+            case SPV_OP_TYPE_IMAGE:
+            case SPV_OP_TYPE_SAMPLER:
+            case SPV_OP_TYPE_SAMPLED_IMAGE:
+            case SPV_OP_TYPE_ARRAY:
+            case SPV_OP_TYPE_RUNTIME_ARRAY:
+            case SPV_OP_TYPE_STRUCT:
+            case SPV_OP_TYPE_POINTER:
+                result = length > 1 ? code[i + 1] : 0;
+                break;
+            case SPV_OP_CONSTANT:
+            case SPV_OP_SPEC_CONSTANT_TRUE:
+            case SPV_OP_SPEC_CONSTANT_FALSE:
+            case SPV_OP_SPEC_CONSTANT:
+            case SPV_OP_VARIABLE:
+                result = length > 2 ? code[i + 2] : 0;
+                break;
+            case SPV_OP_ENTRY_POINT:
+                if(!found_entry && length > 1) {
+                    static const VkShaderStageFlagBits STAGES[] = {
+                        VK_SHADER_STAGE_VERTEX_BIT,
+                        VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+                        VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+                        VK_SHADER_STAGE_GEOMETRY_BIT,
+                        VK_SHADER_STAGE_FRAGMENT_BIT,
+                        VK_SHADER_STAGE_COMPUTE_BIT
+                    };
+
+                    if(code[i + 1] > 5) {
+                        return false;
+                    }
+                    *stage = STAGES[code[i + 1]];
+                    found_entry = true;
+                }
+                break;
+            case SPV_OP_DECORATE: {
+                if(length < 3 || code[i + 1] >= module->id_bound) {
+                    return false;
+                }
+
+                spirv_id_* target = &module->ids[code[i + 1]];
+                uint32_t value = length > 3 ? code[i + 3] : 0;
+
+                switch(code[i + 2]) {
+                    case SPV_DECORATION_DESCRIPTOR_SET:
+                        target->flags |= ID_HAS_SET;
+                        target->set = value;
+                        break;
+                    case SPV_DECORATION_BINDING:
+                        target->flags |= ID_HAS_BINDING;
+                        target->binding = value;
+                        break;
+                    case SPV_DECORATION_LOCATION:
+                        target->flags |= ID_HAS_LOCATION;
+                        target->location = value;
+                        break;
+                    case SPV_DECORATION_SPEC_ID:
+                        target->flags |= ID_HAS_SPEC_ID;
+                        target->spec_id = value;
+                        break;
+                    case SPV_DECORATION_BUILT_IN:
+                        target->flags |= ID_BUILT_IN;
+                        break;
+                    case SPV_DECORATION_BLOCK:
+                        target->flags |= ID_BLOCK;
+                        break;
+                    case SPV_DECORATION_BUFFER_BLOCK:
+                        target->flags |= ID_BUFFER_BLOCK;
+                        break;
+                    case SPV_DECORATION_ARRAY_STRIDE:
+                        target->array_stride = value;
+                        break;
+                }
+                break;
+            }
+        }
+
+        if(result != 0) {
+            if(result >= module->id_bound) {
+                return false;
+            }
+
+            module->ids[result].opcode = opcode;
+            module->ids[result].offset = i;
+        }
+
+        i += length;
+    }
+
+    return found_entry;
+}
+
+/**
+ * Records one variable of the module's interface.
+ *
+ * Returns:
+ *   false if a REFLECT_MAX_* limit was hit
+ */
+static bool reflect_variable_(const spirv_module_* module, uint32_t id,
+        shader_reflection* out) {
+    const spirv_id_* var = &module->ids[id];
+    const uint32_t* inst = module->code + var->offset;
+    uint32_t storage = inst[3];
+
+    const uint32_t* pointer = id_instruction_(module, inst[1]);
+    if(pointer == NULL || (pointer[0] & 0xFFFF) != SPV_OP_TYPE_POINTER) {
+        return true;
+    }
+    uint32_t type = pointer[3];
+
+    if(storage == SPV_STORAGE_UNIFORM_CONSTANT || storage == SPV_STORAGE_UNIFORM ||
+            storage == SPV_STORAGE_STORAGE_BUFFER) {
+        VkDescriptorType descriptor_type;
+        uint32_t count = 0;
+
+        if((var->flags & (ID_HAS_SET | ID_HAS_BINDING)) != (ID_HAS_SET | ID_HAS_BINDING) ||
+                !descriptor_info_(module, storage, type, &descriptor_type, &count)) {
+            return true;
+        }
+
+        if(out->binding_count == REFLECT_MAX_BINDINGS || var->set >= REFLECT_MAX_SETS) {
+            return false;
+        }
+
+        reflected_binding* binding = &out->bindings[out->binding_count++];
+        binding->set = var->set;
+        binding->binding.binding = var->binding;
+        binding->binding.descriptorType = descriptor_type;
+        binding->binding.descriptorCount = count;
+        binding->binding.stageFlags = out->stage;
+        binding->binding.pImmutableSamplers = NULL;
+    }
+    else if(storage == SPV_STORAGE_PUSH_CONSTANT) {
+        // The range starts at the block's first member
+        const uint32_t* block = id_instruction_(module, type);
+        uint32_t start = UINT32_MAX;
+        for(uint32_t m = 0; block != NULL && m < (block[0] >> 16) - 2; m++) {
+            uint32_t offset = 0;
+            member_decoration_(module, type, m, SPV_DECORATION_OFFSET, &offset);
+            if(offset < start) {
+                start = offset;
+            }
+        }
+
+        uint32_t end = type_size_(module, type);
+        if(start == UINT32_MAX || end <= start) {
+            return true;
+        }
+
+        out->push_constants.stageFlags = out->stage;
+        out->push_constants.offset = start;
+        out->push_constants.size = end - start;
+    }
+    else if(storage == SPV_STORAGE_INPUT && out->stage == VK_SHADER_STAGE_VERTEX_BIT) {
+        if((var->flags & ID_HAS_LOCATION) == 0 || (var->flags & ID_BUILT_IN) != 0) {
+            return true;
+        }
+
+        if(out->vertex_input_count == REFLECT_MAX_VERTEX_INPUTS) {
+            return false;
+        }
+
+        reflected_vertex_input* input = &out->vertex_inputs[out->vertex_input_count++];
+        input->location = var->location;
+        input->format = vertex_format_(module, type);
+    }
+
+    return true;
+}
+
+bool reflect_spirv(const uint32_t* code, size_t size, shader_reflection* out) {
+    memset(out, 0, sizeof(shader_reflection));
+
+    if(size < 5 * sizeof(uint32_t) || size % sizeof(uint32_t) != 0 ||
+            code[0] != SPIRV_MAGIC) {
+        fprintf(stderr, "Not a SPIR-V module\n");
+        return false;
+    }
+
+    spirv_module_ module;
+    module.code = code;
+    module.word_count = (uint32_t)(size / sizeof(uint32_t));
+    module.id_bound = code[3];
+    module.ids = (spirv_id_*)calloc(module.id_bound, sizeof(spirv_id_));
+
+    bool success = module.ids != NULL && parse_module_(&module, &out->stage);
+
+    for(uint32_t id = 1; id < module.id_bound && success; id++) {
+        const spirv_id_* info = &module.ids[id];
+
+        if(info->opcode == SPV_OP_VARIABLE) {
+            success = reflect_variable_(&module, id, out);
+        }
+        else if((info->opcode == SPV_OP_SPEC_CONSTANT ||
+                    info->opcode == SPV_OP_SPEC_CONSTANT_TRUE ||
+                    info->opcode == SPV_OP_SPEC_CONSTANT_FALSE) &&
+                (info->flags & ID_HAS_SPEC_ID) != 0) {
+            if(out->spec_constant_count == REFLECT_MAX_SPEC_CONSTANTS) {
+                success = false;
+                break;
+            }
+
+            reflected_spec_constant* constant = &out->spec_constants[out->spec_constant_count++];
+            constant->id = info->spec_id;
+            constant->size = type_size_(&module, code[info->offset + 1]);
+        }
+    }
+
+    free(module.ids);
+
+    if(!success) {
+        fprintf(stderr, "Unable to reflect SPIR-V module\n");
+    }
+
+    return success;
+}
+
+bool merge_shader_reflections(const shader_reflection* stages,
+        uint32_t stage_count, pipeline_layout_desc* out) {
+    memset(out, 0, sizeof(pipeline_layout_desc));
+
+    uint32_t push_end = 0;
+
+    for(uint32_t s = 0; s < stage_count; s++) {
+        const shader_reflection* stage = &stages[s];
+
+        for(uint32_t b = 0; b < stage->binding_count; b++) {
+            const reflected_binding* reflected = &stage->bindings[b];
+            set_layout_desc* set = &out->sets[reflected->set];
+
+            if(reflected->set + 1 > out->set_count) {
+                out->set_count = reflected->set + 1;
+            }
+
+            // Insert sorted by binding, merging stages of the same one
+            uint32_t at = 0;
+            while(at < set->binding_count &&
+                    set->bindings[at].binding < reflected->binding.binding) {
+                at++;
+            }
+
+            if(at < set->binding_count &&
+                    set->bindings[at].binding == reflected->binding.binding) {
+                VkDescriptorSetLayoutBinding* existing = &set->bindings[at];
+
+                if(existing->descriptorType != reflected->binding.descriptorType) {
+                    fprintf(stderr, "Stages disagree on set %i binding %i\n",
+                        reflected->set, reflected->binding.binding);
+                    return false;
+                }
+
+                existing->stageFlags |= reflected->binding.stageFlags;
+                if(reflected->binding.descriptorCount > existing->descriptorCount) {
+                    existing->descriptorCount = reflected->binding.descriptorCount;
+                }
+                continue;
+            }
+
+            if(set->binding_count == REFLECT_MAX_BINDINGS) {
+                return false;
+            }
+
+            memmove(&set->bindings[at + 1], &set->bindings[at],
+                (set->binding_count - at) * sizeof(VkDescriptorSetLayoutBinding));
+            set->bindings[at] = reflected->binding;
+            set->binding_count++;
+        }
+
+        const VkPushConstantRange* push = &stage->push_constants;
+        if(push->size > 0) {
+            if(out->push_constants.size == 0 || push->offset < out->push_constants.offset) {
+                out->push_constants.offset = push->offset;
+            }
+            if(push->offset + push->size > push_end) {
+                push_end = push->offset + push->size;
+            }
+            out->push_constants.stageFlags |= push->stageFlags;
+            out->push_constants.size = push_end - out->push_constants.offset;
+        }
+    }
+
+    return true;
+}
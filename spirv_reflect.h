@@ -0,0 +1,112 @@
+#ifndef SPIRV_REFLECT_H
+#define SPIRV_REFLECT_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define REFLECT_MAX_SETS 4
+#define REFLECT_MAX_BINDINGS 16
+#define REFLECT_MAX_VERTEX_INPUTS 16
+#define REFLECT_MAX_SPEC_CONSTANTS 16
+
+/**
+ * A descriptor used by a shader. descriptorCount is 0 for runtime
+ * sized arrays, the caller decides how large those get.
+ */
+typedef struct {
+    uint32_t set;
+    VkDescriptorSetLayoutBinding binding;
+} reflected_binding;
+
+typedef struct {
+    uint32_t location;
+    VkFormat format;
+} reflected_vertex_input;
+
+typedef struct {
+    uint32_t id;
+    uint32_t size;
+} reflected_spec_constant;
+
+/**
+ * Interface of a single shader module. push_constants.size is 0 if
+ * the shader has no push constant block.
+ */
+typedef struct {
+    VkShaderStageFlagBits stage;
+
+    reflected_binding bindings[REFLECT_MAX_BINDINGS];
+    uint32_t binding_count;
+
+    VkPushConstantRange push_constants;
+
+    // Only filled in for vertex shaders
+    reflected_vertex_input vertex_inputs[REFLECT_MAX_VERTEX_INPUTS];
+    uint32_t vertex_input_count;
+
+    reflected_spec_constant spec_constants[REFLECT_MAX_SPEC_CONSTANTS];
+    uint32_t spec_constant_count;
+} shader_reflection;
+
+/**
+ * Descriptor set bindings of one set, sorted by binding number.
+ * Reflection leaves the flags zero, they are for sets whose layout
+ * the application defines, like the bindless table.
+ */
+typedef struct {
+    VkDescriptorSetLayoutBinding bindings[REFLECT_MAX_BINDINGS];
+    VkDescriptorBindingFlags binding_flags[REFLECT_MAX_BINDINGS];
+    uint32_t binding_count;
+
+    VkDescriptorSetLayoutCreateFlags flags;
+} set_layout_desc;
+
+/**
+ * Everything needed to create a pipeline layout, merged from all
+ * stages of a pipeline. Sets the shaders don't use in between used
+ * ones are empty.
+ */
+typedef struct {
+    set_layout_desc sets[REFLECT_MAX_SETS];
+    uint32_t set_count;
+
+    VkPushConstantRange push_constants;
+} pipeline_layout_desc;
+
+/**
+ * Walks the words of a SPIR-V module and collects its descriptor
+ * bindings, push constant block, vertex inputs and specialization
+ * constants. Only the first entry point is looked at.
+ *
+ * Params:
+ *   code - SPIR-V words
+ *   size - size of code in bytes
+ *   out  - receives the interface
+ *
+ * Returns:
+ *   false if the module is malformed or uses more resources than
+ *   the REFLECT_MAX_* limits
+ */
+bool reflect_spirv(const uint32_t* code, size_t size, shader_reflection* out);
+
+/**
+ * Merges the interfaces of all stages of a pipeline. A binding used
+ * by several stages gets all of their stage flags, and the push
+ * constant range covers every stage's block.
+ *
+ * Params:
+ *   stages      - reflected stages
+ *   stage_count - number of stages
+ *   out         - receives the layout description
+ *
+ * Returns:
+ *   false if stages disagree on the type of a binding
+ */
+bool merge_shader_reflections(const shader_reflection* stages,
+        uint32_t stage_count, pipeline_layout_desc* out);
+
+#endif
@@ -0,0 +1,52 @@
+#include "timeline.h"
+
+#include <stdio.h>
+
+bool create_timeline_semaphore(VkDevice device, uint64_t initial_value,
+        VkSemaphore* out) {
+    VkSemaphoreTypeCreateInfo type_info = {};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue = initial_value;
+
+    VkSemaphoreCreateInfo sem_info = {};
+    sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    sem_info.pNext = &type_info;
+
+    VkResult result = vkCreateSemaphore(device, &sem_info, NULL, out);
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to create timeline semaphore\n");
+        *out = VK_NULL_HANDLE;
+    }
+
+    return result == VK_SUCCESS;
+}
+
+bool timeline_reached(VkDevice device, VkSemaphore timeline, uint64_t value) {
+    uint64_t current = 0;
+    VkResult result = vkGetSemaphoreCounterValue(device, timeline, &current);
+
+    return result == VK_SUCCESS && current >= value;
+}
+
+bool wait_timeline(VkDevice device, VkSemaphore timeline, uint64_t value) {
+    // Usually the value was reached long ago, skip the blocking wait
+    if(timeline_reached(device, timeline, value)) {
+        return true;
+    }
+
+    VkSemaphoreWaitInfo wait_info = {};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &timeline;
+    wait_info.pValues = &value;
+
+    VkResult result = vkWaitSemaphores(device, &wait_info, UINT64_MAX);
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to wait on timeline semaphore\n");
+    }
+
+    return result == VK_SUCCESS;
+}
@@ -0,0 +1,40 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Creates a timeline semaphore (Vulkan 1.2) starting at
+ * initial_value.
+ * 
+ * Params:
+ *   device        - logical device
+ *   initial_value - initial counter value
+ *   out           - receives the semaphore
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool create_timeline_semaphore(VkDevice device, uint64_t initial_value,
+        VkSemaphore* out);
+
+/**
+ * Checks whether a timeline semaphore has reached value without
+ * blocking.
+ */
+bool timeline_reached(VkDevice device, VkSemaphore timeline, uint64_t value);
+
+/**
+ * Blocks until a timeline semaphore reaches value. Values that were
+ * already reached return after a single counter read.
+ * 
+ * Returns:
+ *   false if the wait failed, e.g. the device was lost
+ */
+bool wait_timeline(VkDevice device, VkSemaphore timeline, uint64_t value);
+
+#endif
@@ -0,0 +1,169 @@
+#include "uniform_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Every stage the renderer uses can read the ring
+#define UNIFORM_RING_STAGES (VK_SHADER_STAGE_VERTEX_BIT | \
+    VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+
+bool init_uniform_ring(uniform_ring* ring, VkDevice device,
+        VkPhysicalDevice physical_device, gpu_allocator* allocator,
+        layout_cache* layouts, VkDeviceSize segment_size,
+        uint32_t segment_count, VkDeviceSize range) {
+    memset(ring, 0, sizeof(uniform_ring));
+    ring->allocator = allocator;
+    ring->device = device;
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physical_device, &props);
+
+    // Segments start aligned so offsets inside them only need
+    // rounding relative to the segment
+    ring->alignment = props.limits.minUniformBufferOffsetAlignment;
+    ring->range = range;
+    ring->segment_size = uniform_ring_align(ring, segment_size + range);
+    ring->segment_count = segment_count;
+
+    if(range > props.limits.maxUniformBufferRange ||
+            ring->segment_size * segment_count > UINT32_MAX) {
+        fprintf(stderr, "Uniform ring is too large for dynamic offsets\n");
+        return false;
+    }
+
+    // Host coherent, so writes need no flush before the submit
+    if(!create_gpu_buffer(allocator, ring->segment_size * segment_count,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            NULL, 0, &ring->buffer)) {
+        fprintf(stderr, "Unable to create uniform ring buffer\n");
+        return false;
+    }
+    ring->mapped = (uint8_t*)ring->buffer.allocation.mapped;
+
+    set_layout_desc* desc = &ring->layout_desc;
+    desc->binding_count = 1;
+    desc->bindings[0].binding = UNIFORM_RING_BINDING;
+    desc->bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    desc->bindings[0].descriptorCount = 1;
+    desc->bindings[0].stageFlags = UNIFORM_RING_STAGES;
+
+    bool success = get_descriptor_set_layout(layouts, desc, &ring->set_layout);
+
+    VkDescriptorPoolSize pool_size = {};
+    pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    pool_size.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+
+    success = success &&
+        vkCreateDescriptorPool(device, &pool_info, NULL, &ring->pool) == VK_SUCCESS;
+
+    if(success) {
+        VkDescriptorSetAllocateInfo set_info = {};
+        set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        set_info.descriptorPool = ring->pool;
+        set_info.descriptorSetCount = 1;
+        set_info.pSetLayouts = &ring->set_layout;
+
+        success = vkAllocateDescriptorSets(device, &set_info, &ring->set) == VK_SUCCESS;
+    }
+
+    if(!success) {
+        fprintf(stderr, "Unable to create uniform ring descriptor set\n");
+        cleanup_uniform_ring(ring);
+        return false;
+    }
+
+    // Written once, every bind only moves the dynamic offset
+    VkDescriptorBufferInfo buffer_info = {};
+    buffer_info.buffer = ring->buffer.buffer;
+    buffer_info.offset = 0;
+    buffer_info.range = range;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = ring->set;
+    write.dstBinding = UNIFORM_RING_BINDING;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    write.pBufferInfo = &buffer_info;
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+
+    begin_uniform_segment(ring, 0);
+
+    printf("Uniform ring has %i segments of %llu bytes\n", segment_count,
+        (unsigned long long)ring->segment_size);
+    return true;
+}
+
+void cleanup_uniform_ring(uniform_ring* ring) {
+    // Destroying the pool frees the set
+    vkDestroyDescriptorPool(ring->device, ring->pool, NULL);
+
+    if(ring->buffer.buffer != VK_NULL_HANDLE) {
+        destroy_gpu_buffer(ring->allocator, &ring->buffer);
+    }
+
+    memset(ring, 0, sizeof(uniform_ring));
+}
+
+void begin_uniform_segment(uniform_ring* ring, uint32_t segment) {
+    ring->segment_begin = ring->segment_size * (segment % ring->segment_count);
+    ring->head = ring->segment_begin;
+}
+
+VkDeviceSize uniform_ring_align(const uniform_ring* ring, VkDeviceSize size) {
+    VkDeviceSize alignment = ring->alignment > 0 ? ring->alignment : 1;
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+void* uniform_ring_alloc(uniform_ring* ring, VkDeviceSize size,
+        uint32_t* offset) {
+    VkDeviceSize start = ring->segment_begin +
+        uniform_ring_align(ring, ring->head - ring->segment_begin);
+    VkDeviceSize usable_end = ring->segment_begin + ring->segment_size - ring->range;
+
+    if(start + size > usable_end) {
+        return NULL;
+    }
+
+    ring->head = start + size;
+    *offset = (uint32_t)start;
+
+    return ring->mapped + start;
+}
+
+bool uniform_ring_patch_layout(const uniform_ring* ring,
+        pipeline_layout_desc* desc) {
+    if(desc->set_count <= UNIFORM_RING_SET ||
+            desc->sets[UNIFORM_RING_SET].binding_count == 0) {
+        return true;
+    }
+
+    const set_layout_desc* used = &desc->sets[UNIFORM_RING_SET];
+    const VkDescriptorSetLayoutBinding* binding = &used->bindings[0];
+
+    if(used->binding_count != 1 || binding->binding != UNIFORM_RING_BINDING ||
+            binding->descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
+            binding->descriptorCount != 1) {
+        fprintf(stderr, "Set %i must hold a single uniform block at binding %i\n",
+            UNIFORM_RING_SET, UNIFORM_RING_BINDING);
+        return false;
+    }
+
+    desc->sets[UNIFORM_RING_SET] = ring->layout_desc;
+    return true;
+}
+
+void cmd_bind_uniform_ring(VkCommandBuffer cmd, const uniform_ring* ring,
+        VkPipelineBindPoint bind_point, VkPipelineLayout layout,
+        uint32_t offset) {
+    vkCmdBindDescriptorSets(cmd, bind_point, layout, UNIFORM_RING_SET, 1,
+        &ring->set, 1, &offset);
+}
@@ -0,0 +1,129 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "allocator.h"
+#include "buffer.h"
+#include "layout_cache.h"
+#include "spirv_reflect.h"
+
+// Where the ring is bound. Shaders declare a plain uniform block,
+//   layout(std140, set = 1, binding = 0) uniform ... { ... };
+// which pipeline layouts turn into a dynamic uniform buffer.
+#define UNIFORM_RING_SET 1
+#define UNIFORM_RING_BINDING 0
+
+/**
+ * A persistently mapped uniform buffer split into one segment per
+ * frame in flight. Callers bump-allocate from the current frame's
+ * segment, write their data straight into the mapping and bind the
+ * ring's single descriptor set with the allocation's offset as a
+ * dynamic offset. A segment is reused once its frame has retired.
+ *
+ * Allocation is not thread safe, do it before handing recording off
+ * to workers.
+ */
+typedef struct {
+    gpu_allocator* allocator;
+    VkDevice device;
+
+    gpu_buffer buffer;
+    uint8_t* mapped;
+
+    VkDeviceSize alignment;
+    VkDeviceSize segment_size;
+    uint32_t segment_count;
+
+    // Largest uniform block a shader reads through the ring. The
+    // last range bytes of every segment are never handed out, so a
+    // block at any allocated offset stays inside its segment.
+    VkDeviceSize range;
+
+    VkDeviceSize segment_begin;
+    VkDeviceSize head;
+
+    set_layout_desc layout_desc;
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+} uniform_ring;
+
+/**
+ * Creates the ring buffer and its descriptor set.
+ *
+ * Params:
+ *   ring            - ring to initialize
+ *   device          - logical device
+ *   physical_device - physical device, for its alignment limits
+ *   allocator       - allocator the buffer comes from
+ *   layouts         - layout cache the set layout is created through
+ *   segment_size    - bytes available to each frame
+ *   segment_count   - frames in flight
+ *   range           - size of the largest uniform block
+ *
+ * Returns:
+ *   bool indicating success
+ */
+bool init_uniform_ring(uniform_ring* ring, VkDevice device,
+        VkPhysicalDevice physical_device, gpu_allocator* allocator,
+        layout_cache* layouts, VkDeviceSize segment_size,
+        uint32_t segment_count, VkDeviceSize range);
+
+/**
+ * Destroys the buffer and descriptor set. Nothing may still be using
+ * them.
+ */
+void cleanup_uniform_ring(uniform_ring* ring);
+
+/**
+ * Starts allocating from a frame's segment, discarding whatever it
+ * held. The GPU must be done with the frame that last used it.
+ */
+void begin_uniform_segment(uniform_ring* ring, uint32_t segment);
+
+/**
+ * Rounds a size up to the ring's offset alignment, e.g. to get the
+ * stride of an array of uniform blocks.
+ */
+VkDeviceSize uniform_ring_align(const uniform_ring* ring, VkDeviceSize size);
+
+/**
+ * Reserves size bytes in the current segment.
+ *
+ * Params:
+ *   ring   - uniform ring
+ *   size   - bytes to reserve
+ *   offset - receives the dynamic offset of the reservation
+ *
+ * Returns:
+ *   mapped pointer to write the data to, or NULL if the segment is
+ *   full
+ */
+void* uniform_ring_alloc(uniform_ring* ring, VkDeviceSize size,
+        uint32_t* offset);
+
+/**
+ * Turns the uniform block a pipeline's shaders declare at
+ * UNIFORM_RING_SET into the ring's dynamic uniform buffer. Layouts
+ * whose shaders don't use the set are left alone.
+ *
+ * Returns:
+ *   false if the shaders declare something else in UNIFORM_RING_SET
+ */
+bool uniform_ring_patch_layout(const uniform_ring* ring,
+        pipeline_layout_desc* desc);
+
+/**
+ * Binds the ring at UNIFORM_RING_SET with a dynamic offset returned
+ * by uniform_ring_alloc.
+ */
+void cmd_bind_uniform_ring(VkCommandBuffer cmd, const uniform_ring* ring,
+        VkPipelineBindPoint bind_point, VkPipelineLayout layout,
+        uint32_t offset);
+
+#endif
@@ -1,6 +1,17 @@
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
 uint32_t* read_file(const char* filename, size_t* length) {
 
@@ -31,3 +42,142 @@ uint32_t* read_file(const char* filename, size_t* length) {
 
     return (uint32_t*)contents;
 }
+
+/**
+ * Maps a whole file read-only.
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+static bool map_file_(const char* filename, mapped_file* out) {
+    out->data = NULL;
+    out->size = 0;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if(GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if(mapping != NULL) {
+            out->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            out->size = (size_t)size.QuadPart;
+
+            // The view keeps the mapping alive on its own
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if(data != MAP_FAILED) {
+            out->data = data;
+            out->size = (size_t)st.st_size;
+        }
+    }
+
+    // The mapping keeps its own reference to the file
+    close(fd);
+#endif
+
+    return out->data != NULL;
+}
+
+bool map_spirv_file(const char* filename, mapped_file* out) {
+    if(!map_file_(filename, out)) {
+        fprintf(stderr, "Unable to map file: \"%s\"\n", filename);
+        return false;
+    }
+
+    const uint32_t* words = (const uint32_t*)out->data;
+    bool valid = true;
+
+    if(((uintptr_t)out->data % sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "Mapping of \"%s\" is not word aligned\n", filename);
+        valid = false;
+    }
+    else if(out->size % sizeof(uint32_t) != 0) {
+        fprintf(stderr, "\"%s\" is not a whole number of SPIR-V words\n", filename);
+        valid = false;
+    }
+    else if(words[0] != SPIRV_MAGIC) {
+        fprintf(stderr, "\"%s\" is not a SPIR-V binary\n", filename);
+        valid = false;
+    }
+
+    if(!valid) {
+        unmap_file(out);
+    }
+
+    return valid;
+}
+
+void unmap_file(mapped_file* file) {
+    if(file->data == NULL) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(file->data);
+#else
+    munmap((void*)file->data, file->size);
+#endif
+
+    file->data = NULL;
+    file->size = 0;
+}
+
+void* calloc_aligned(size_t alignment, size_t count, size_t size) {
+    size_t bytes = count * size;
+    void* ptr = NULL;
+
+#ifdef _WIN32
+    ptr = _aligned_malloc(bytes, alignment);
+#else
+    if(posix_memalign(&ptr, alignment, bytes) != 0) {
+        ptr = NULL;
+    }
+#endif
+
+    if(ptr != NULL) {
+        memset(ptr, 0, bytes);
+    }
+
+    return ptr;
+}
+
+void free_aligned(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+double get_time_seconds() {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+
+    return (double)counter.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
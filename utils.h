@@ -1,6 +1,21 @@
+#ifndef UTILS_H
+#define UTILS_H
+
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
+// First word of every SPIR-V module
+#define SPIRV_MAGIC 0x07230203
+
+/**
+ * A file mapped read-only into memory.
+ */
+typedef struct {
+    const void* data;
+    size_t size;
+} mapped_file;
+
 /**
  * Utility function for reading contents of file.
  * 
@@ -11,3 +26,46 @@
  *   string containing file contents.
  */
 uint32_t* read_file(const char* filename, size_t* length);
+
+/**
+ * Maps a SPIR-V binary read-only without copying it. The mapping is
+ * page aligned, so data can be handed to vkCreateShaderModule as is.
+ * Fails if the file isn't a whole number of words or doesn't start
+ * with the SPIR-V magic number.
+ * 
+ * Params:
+ *   filename - path to .spv file
+ *   out      - receives the mapping
+ * 
+ * Returns:
+ *   bool indicating success
+ */
+bool map_spirv_file(const char* filename, mapped_file* out);
+
+/**
+ * Unmaps a file mapped with map_spirv_file.
+ */
+void unmap_file(mapped_file* file);
+
+/**
+ * Allocates zeroed memory for count elements of size bytes, aligned
+ * to alignment. Alignment must be a power of two and a multiple of
+ * sizeof(void*).
+ * 
+ * Returns:
+ *   the memory, to be released with free_aligned, or NULL
+ */
+void* calloc_aligned(size_t alignment, size_t count, size_t size);
+
+/**
+ * Frees memory allocated with calloc_aligned.
+ */
+void free_aligned(void* ptr);
+
+/**
+ * Returns a monotonic timestamp in seconds. Only useful for
+ * measuring elapsed time between two calls.
+ */
+double get_time_seconds();
+
+#endif
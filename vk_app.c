@@ -1,6 +1,13 @@
 #include "vk_app.h"
+#include "buffer.h"
+#include "pipeline_cache.h"
+#include "shaders.h"
+#include "spirv_reflect.h"
+#include "timeline.h"
 #include "utils.h"
 
+#include <ctype.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <math.h>
 #include <stdlib.h>
@@ -13,9 +20,47 @@ const bool ENABLE_VALIDATION_LAYERS = false;
 const bool ENABLE_VALIDATION_LAYERS = true;
 #endif
 
-const int WIDTH = 800;
-const int HEIGHT = 600;
-const int MAX_FRAMES_IN_FLIGHT = 2;
+const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// Scene geometry
+const vertex SCENE_VERTICES[] = {
+    {{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+    {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+    {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+};
+const uint32_t SCENE_VERTEX_COUNT = 3;
+
+const uint32_t SCENE_INDICES[] = {
+    0, 1, 2
+};
+const uint32_t SCENE_INDEX_COUNT = 3;
+
+// Vertex binding of the per-instance data, see instance_data
+const uint32_t INSTANCE_BINDING = 0;
+
+// Largest instance count the instance benchmark steps up to
+const uint32_t MAX_BENCHMARK_INSTANCES = 1000000;
+
+// Tints instances cycle through, the first leaves colors unchanged
+const float INSTANCE_TINTS[][3] = {
+    {1.0f, 1.0f, 1.0f},
+    {1.0f, 0.6f, 0.6f},
+    {0.6f, 1.0f, 0.6f},
+    {0.6f, 0.6f, 1.0f}
+};
+const uint32_t INSTANCE_TINT_COUNT = 4;
+
+// Must match local_size_x in shader.comp
+const uint32_t ANIMATE_GROUP_SIZE = 64;
+
+// Slots requested from the bindless table, clamped to device limits
+const uint32_t BINDLESS_BUFFER_CAPACITY = 1024;
+const uint32_t BINDLESS_TEXTURE_CAPACITY = 4096;
+
+// Uniform ring space per frame on top of the scene's draws, and the
+// largest uniform block shaders may read through it
+const VkDeviceSize UNIFORM_RING_SEGMENT_SIZE = 64 * 1024;
+const VkDeviceSize UNIFORM_BLOCK_MAX_SIZE = 256;
 
 // Validation layers
 const char* VALIDATION_LAYERS[] = {
@@ -29,11 +74,46 @@ const char* DEVICE_EXTENSIONS[] = {
 };
 const uint32_t DEVICE_EXTENSIONS_COUNT = 1;
 
+// Caps on the device score's memory and image size terms, so that
+// together with the smaller terms they stay below the 1000000 between
+// device types
+const VkDeviceSize MAX_SCORED_HEAP_MIB = 512 * 1024;
+const uint32_t MAX_SCORED_IMAGE_DIMENSION = 65536;
+
+// Required plus every optional extension
+#define MAX_DEVICE_EXTENSIONS 8
+
+// Bounds present waits so an occluded window can't stall the loop
+const uint64_t PRESENT_WAIT_TIMEOUT_NS = 100000000;
+
+// Where hot reload finds shader sources and puts recompiled SPIR-V.
+// The build points these at the source and build trees.
+#ifndef LRN_VK_SHADER_SOURCE_DIR
+#define LRN_VK_SHADER_SOURCE_DIR "shaders"
+#endif
+#ifndef LRN_VK_HOT_SHADER_DIR
+#define LRN_VK_HOT_SHADER_DIR "shaders_hot"
+#endif
+#ifndef LRN_VK_SHADER_COMPILER
+#define LRN_VK_SHADER_COMPILER "glslc"
+#define LRN_VK_SHADER_COMPILER_IS_GLSLANG 0
+#endif
+
+// Shaders each pipeline is built from, so a changed source only
+// rebuilds the pipelines using it
+const char* SCENE_SHADERS[] = {
+    "shader.vert",
+    "shader.frag"
+};
+const uint32_t SCENE_SHADER_COUNT = 2;
+const char* ANIMATE_SHADER = "shader.comp";
+
 // "Private" interface
 void init_window_(vk_app*);
+void framebuffer_resize_cb_(GLFWwindow*, int, int);
 bool init_vulkan_(vk_app*);
 
-char** get_required_extensions_(uint32_t*);
+char** get_required_extensions_(const vk_app*, uint32_t*);
 bool init_instance_(vk_app*);
 
 bool setup_debug_messenger_(vk_app*);
@@ -43,29 +123,78 @@ bool create_surface_(vk_app*);
 
 bool pick_physical_device_(vk_app*);
 bool is_device_suitable_(VkPhysicalDevice, VkSurfaceKHR);
+uint64_t score_device_(VkPhysicalDevice, VkSurfaceKHR);
+bool get_device_uuid_(VkPhysicalDevice, uint8_t*);
+bool device_matches_override_(VkPhysicalDevice, const char*);
 bool device_supports_exts_(VkPhysicalDevice);
+bool device_supports_timelines_(VkPhysicalDevice);
+bool device_supports_bindless_(VkPhysicalDevice);
+bool device_has_extension_(VkPhysicalDevice, const char*);
+bool device_supports_present_wait_(VkPhysicalDevice);
+bool device_supports_dynamic_rendering_(VkPhysicalDevice);
+void query_extended_dynamic_state_(VkPhysicalDevice, dynamic_state_table*);
 queue_families find_queue_families_(VkPhysicalDevice, VkSurfaceKHR);
 
 bool create_logical_device_(vk_app*);
 
 bool create_render_pass_(vk_app*);
+void check_vertex_inputs_(const shader_reflection*, const graphics_pipeline_desc*);
+bool patch_pipeline_layout_(vk_app*, pipeline_layout_desc*);
+bool get_reflected_layout_(vk_app*, const shader_reflection*, uint32_t, VkPipelineLayout*);
+bool fill_scene_pipeline_desc_(vk_app*, graphics_pipeline_desc*);
 bool create_graphics_pipeline_(vk_app*);
+void destroy_graphics_pipeline_(vk_app*);
 VkShaderModule create_shader_module(vk_app*, const uint32_t*, size_t);
+VkShaderModule load_shader_module_(vk_app*, const char*, shader_reflection*);
 
 swapchain_details get_swapchain_support_(VkPhysicalDevice, VkSurfaceKHR);
 VkSurfaceFormatKHR choose_swap_surface_format_(VkSurfaceFormatKHR*, uint32_t);
-VkPresentModeKHR choose_present_mode_(VkPresentModeKHR*, uint32_t);
-VkExtent2D choose_swap_extent_(const VkSurfaceCapabilitiesKHR* const capabilities);
+VkPresentModeKHR choose_present_mode_(VkPresentModeKHR*, uint32_t, VkPresentModeKHR);
+uint32_t choose_swap_image_count_(const VkSurfaceCapabilitiesKHR*, uint32_t);
+VkExtent2D choose_swap_extent_(GLFWwindow*, const VkSurfaceCapabilitiesKHR* const capabilities);
 bool create_swapchain_(vk_app*);
+bool recreate_swapchain_(vk_app*);
+void cleanup_swapchain_(vk_app*);
+bool create_offscreen_targets_(vk_app*);
 bool create_image_views_(vk_app*);
 bool create_framebuffers_(vk_app*);
 
-bool create_cmd_pool_(vk_app*);
+bool create_frame_contexts_(vk_app*);
+void cleanup_frame_contexts_(vk_app*);
+bool create_cmd_pools_(vk_app*);
 bool create_cmd_buffers_(vk_app*);
+bool create_scene_buffers_(vk_app*);
+uint32_t grid_columns_(uint32_t);
+bool upload_instances_(vk_app*, uint32_t);
+bool create_compute_pass_(vk_app*);
+bool record_compute_cmd_(vk_app*, uint32_t);
+bool create_record_workers_(vk_app*);
+bool record_secondary_draws_(vk_app*, uint32_t);
+bool record_cmd_buffer_(vk_app*, VkCommandBuffer, uint32_t, uint32_t);
+void cmd_transition_image_(VkCommandBuffer, VkImage, VkImageLayout, VkImageLayout,
+        VkPipelineStageFlags, VkAccessFlags, VkPipelineStageFlags, VkAccessFlags);
+bool write_draw_uniforms_(vk_app*, uint32_t);
+void record_draws_(void*, VkCommandBuffer, uint32_t, uint32_t);
 
 bool create_sync_objects_(vk_app*);
-
+bool create_timestamp_queries_(vk_app*);
+void read_frame_timestamps_(vk_app*, uint32_t);
+void print_frame_stats_(const vk_app*);
+void print_memory_stats_(const vk_app*);
+
+bool init_hot_reload_(vk_app*);
+void poll_shader_changes_(vk_app*);
+void reload_scene_pipeline_(vk_app*);
+void reload_animate_pipeline_(vk_app*);
+void update_pipeline_reloads_(vk_app*);
+void retire_pipeline_(vk_app*, pipeline_handle, VkPipeline, VkSemaphore, uint64_t);
+void release_retired_pipelines_(vk_app*, bool);
+
+void wait_for_last_present_(vk_app*);
+void abandon_acquired_image_(vk_app*, frame_context*);
 void draw_frame_(vk_app*);
+bool step_frame_(vk_app*);
+void run_instance_benchmark_(vk_app*);
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debug_cb(
         VkDebugUtilsMessageSeverityFlagBitsEXT,
@@ -77,10 +206,29 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debug_cb(
 /**
  * Initializes the vulkan app struct.
  * Params:
- *   app - vulkan app struct
+ *   app    - vulkan app struct
+ *   config - how the app should run, copied into app
  */
-bool init_vk_app(vk_app* app) {
-    init_window_(app);
+bool init_vk_app(vk_app* app, const vk_app_config* config) {
+    app->config = *config;
+
+    // Nothing sensible can run with less
+    if(app->config.frames_in_flight == 0) {
+        app->config.frames_in_flight = 1;
+    }
+
+    init_draw_state(&app->scene_draw_state);
+    app->graphics_pipeline = PIPELINE_HANDLE_NONE;
+    app->pending_graphics_pipeline = PIPELINE_HANDLE_NONE;
+    app->pending_pipeline_layout = VK_NULL_HANDLE;
+
+    printf("Running %i frames in flight at %ix%i, preferring %s presentation\n",
+        app->config.frames_in_flight, app->config.width, app->config.height,
+        present_mode_name(app->config.present_mode));
+
+    if(!app->config.headless) {
+        init_window_(app);
+    }
 
     bool success = init_vulkan_(app);
 
@@ -101,75 +249,197 @@ bool init_vk_app(vk_app* app) {
  *   app - vulkan app
  */
 void run_vk_app(vk_app* app) {
-    while(!glfwWindowShouldClose(app->app_window)) {
-        glfwPollEvents();
-        draw_frame_(app);
+    if(app->config.instance_benchmark_frames > 0) {
+        run_instance_benchmark_(app);
+
+        vkDeviceWaitIdle(app->device);
+        print_memory_stats_(app);
+        return;
+    }
+
+    if(app->config.headless) {
+        uint32_t frame_count = app->config.headless_frame_count;
+
+        double start = get_time_seconds();
+        for(uint32_t i = 0; i < frame_count; i++) {
+            draw_frame_(app);
+        }
+        vkDeviceWaitIdle(app->device);
+        double elapsed = get_time_seconds() - start;
+
+        printf("Rendered %i headless frames in %.3f s (%.1f fps)\n",
+            frame_count, elapsed, frame_count / elapsed);
+        print_frame_stats_(app);
+        print_memory_stats_(app);
+        return;
+    }
+
+    while(step_frame_(app)) {
     }
 
     vkDeviceWaitIdle(app->device);
+    print_frame_stats_(app);
+    print_memory_stats_(app);
 }
 
 /**
- * Cleans up the vk app struct.
+ * Returns rolling GPU and CPU frame time statistics over the last
+ * FRAME_STATS_WINDOW frames. CPU times only cover recording and
+ * submitting, not waiting on the GPU or swapchain. GPU times lag the
+ * CPU by the number of frames in flight, and are all zero if the
+ * graphics queue doesn't support timestamps.
  * 
  * Params:
  *   app - vulkan app
  */
-void cleanup_vk_app(vk_app* app) {
+vk_app_frame_stats vk_app_get_frame_stats(const vk_app* app) {
+    vk_app_frame_stats stats;
+    stats.gpu = summarize_frame_times(&app->gpu_frame_times);
+    stats.cpu = summarize_frame_times(&app->cpu_frame_times);
+    stats.present_latency = summarize_frame_times(&app->present_latencies);
+
+    return stats;
+}
+
+/**
+ * Prints the current frame statistics to stdout.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void print_frame_stats_(const vk_app* app) {
+    vk_app_frame_stats stats = vk_app_get_frame_stats(app);
+
+    printf("CPU record and submit time over %i frames: min %.3f ms, avg %.3f ms, p99 %.3f ms\n",
+        stats.cpu.sample_count, stats.cpu.min_ms, stats.cpu.avg_ms, stats.cpu.p99_ms);
+
+    if(app->timestamps_supported) {
+        printf("GPU frame time over %i frames: min %.3f ms, avg %.3f ms, p99 %.3f ms\n",
+            stats.gpu.sample_count, stats.gpu.min_ms, stats.gpu.avg_ms, stats.gpu.p99_ms);
+    }
+
+    if(app->present_wait_enabled) {
+        printf("Input to present latency over %i frames: min %.3f ms, avg %.3f ms, p99 %.3f ms\n",
+            stats.present_latency.sample_count, stats.present_latency.min_ms,
+            stats.present_latency.avg_ms, stats.present_latency.p99_ms);
+    }
+}
+
+/**
+ * Returns device memory usage per heap, as seen by the app's
+ * allocator.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+gpu_allocator_stats vk_app_get_memory_stats(const vk_app* app) {
+    return get_gpu_allocator_stats(&app->allocator);
+}
+
+/**
+ * Prints memory usage of every heap the app allocated from.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void print_memory_stats_(const vk_app* app) {
+    gpu_allocator_stats stats = vk_app_get_memory_stats(app);
+
+    for(uint32_t i = 0; i < stats.heap_count; i++) {
+        const gpu_heap_stats* heap = &stats.heaps[i];
+        if(heap->block_count == 0) {
+            continue;
+        }
 
-    for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroySemaphore(app->device, app->render_finished[i], NULL);
-        vkDestroySemaphore(app->device, app->image_available[i], NULL);
-        vkDestroyFence(app->device, app->in_flight[i], NULL);
+        printf("Heap %i: %i allocations in %i blocks, %llu KiB reserved, "
+            "%llu KiB used, %llu KiB wasted, %llu KiB fragmented\n",
+            i, heap->allocation_count, heap->block_count,
+            (unsigned long long)(heap->reserved_bytes / 1024),
+            (unsigned long long)(heap->used_bytes / 1024),
+            (unsigned long long)(heap->wasted_bytes / 1024),
+            (unsigned long long)(heap->fragmented_bytes / 1024));
     }
-    free(app->image_available);
-    app->image_available = NULL;
+}
 
-    free(app->render_finished);
-    app->render_finished = NULL;
+/**
+ * Cleans up the vk app struct.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void cleanup_vk_app(vk_app* app) {
 
-    free(app->in_flight);
-    app->in_flight = NULL;
+    vkDestroySemaphore(app->device, app->graphics_timeline, NULL);
+    vkDestroySemaphore(app->device, app->compute_timeline, NULL);
 
-    free(app->imgs_in_flight);
-    app->imgs_in_flight = NULL;
+    if(app->config.record_thread_count > 0) {
+        cleanup_record_workers(&app->workers);
+        free(app->secondary_cmds);
+        app->secondary_cmds = NULL;
+    }
 
-    vkDestroyCommandPool(app->device, app->cmd_pool, NULL);
+    cleanup_frame_contexts_(app);
 
-    for(uint32_t i = 0; i < app->framebuffer_count; i++) {
-        vkDestroyFramebuffer(app->device, app->framebuffers[i], NULL);
+    // The device is idle, nothing retired is still in use
+    release_retired_pipelines_(app, true);
+    // The watcher is only set up with hot reload, and cleans up
+    // after itself when that fails
+    if(app->hot_reload_enabled) {
+        cleanup_shader_watcher(&app->watcher);
     }
 
-    vkDestroyPipeline(app->device, app->graphics_pipeline, NULL);
+    destroy_compute_pipeline(app->device, &app->animate_pipeline);
+
+    destroy_gpu_buffer(&app->allocator, &app->instance_buffer);
+    destroy_gpu_buffer(&app->allocator, &app->index_buffer);
+    destroy_gpu_buffer(&app->allocator, &app->vertex_buffer);
+    cleanup_uniform_ring(&app->uniforms);
+    cleanup_buffer_uploader(&app->uploader);
+
+    cleanup_swapchain_(app);
+    destroy_graphics_pipeline_(app);
+    cleanup_pipeline_compiler(&app->pipelines);
+    cleanup_bindless_table(&app->bindless);
+    cleanup_layout_cache(&app->layouts);
 
-    vkDestroyPipelineLayout(app->device, app->pipeline_layout, NULL);
+    save_pipeline_cache(app->device, app->pipeline_cache, PIPELINE_CACHE_PATH);
+    vkDestroyPipelineCache(app->device, app->pipeline_cache, NULL);
 
     vkDestroyRenderPass(app->device, app->render_pass, NULL);
 
-    for(uint32_t i = 0; i < app->swapchain_image_count; i++) {
-        vkDestroyImageView(app->device, app->swapchain_image_views[i], NULL);
+    if(app->config.headless) {
+        // Offscreen targets are owned by us rather than a swapchain
+        for(uint32_t i = 0; i < app->swapchain_image_count; i++) {
+            vkDestroyImage(app->device, app->swapchain_images[i].image, NULL);
+            gpu_free(&app->allocator, &app->swapchain_images[i].memory);
+        }
+    }
+    else {
+        vkDestroySwapchainKHR(app->device, app->swapchain,
+                NULL);
     }
-    free(app->swapchain_image_views);
-    app->swapchain_image_views = NULL;
-
-    vkDestroySwapchainKHR(app->device, app->swapchain,
-            NULL);
 
     // Images are destroyed by swapchain destruction
     free(app->swapchain_images);
     app->swapchain_images = NULL;
 
+    cleanup_gpu_allocator(&app->allocator);
+
     vkDestroyDevice(app->device, NULL);
 
-    vkDestroySurfaceKHR(app->instance, app->surface, NULL);
+    if(!app->config.headless) {
+        vkDestroySurfaceKHR(app->instance, app->surface, NULL);
+    }
 
     cleanup_debug_messenger_(app);
 
     vkDestroyInstance(app->instance, NULL);
 
-    glfwDestroyWindow(app->app_window);
-    app->app_window = NULL;
-    glfwTerminate();
+    if(!app->config.headless) {
+        glfwDestroyWindow(app->app_window);
+        app->app_window = NULL;
+        glfwTerminate();
+    }
 }
 
 /**
@@ -180,9 +450,23 @@ void cleanup_vk_app(vk_app* app) {
  */
 void init_window_(vk_app* app) {
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+
+    app->app_window = glfwCreateWindow((int)app->config.width,
+        (int)app->config.height, "Vulkan Window", NULL, NULL);
+    app->framebuffer_resized = false;
+
+    glfwSetWindowUserPointer(app->app_window, app);
+    glfwSetFramebufferSizeCallback(app->app_window, framebuffer_resize_cb_);
+}
 
-    app->app_window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan Window", NULL, NULL);
+/**
+ * GLFW framebuffer size callback. Flags the swapchain for
+ * recreation at the end of the next frame.
+ */
+void framebuffer_resize_cb_(GLFWwindow* window, int width, int height) {
+    vk_app* app = (vk_app*)glfwGetWindowUserPointer(window);
+    app->framebuffer_resized = true;
 }
 
 /**
@@ -199,6 +483,15 @@ bool init_vulkan_(vk_app* app) {
     bool success = true;
 
     app->current_frame = 0;
+    app->surface = VK_NULL_HANDLE;
+    app->swapchain = VK_NULL_HANDLE;
+    app->swapchain_images = NULL;
+    app->swapchain_image_count = 0;
+    app->frames = NULL;
+
+    if(app->config.scene_draw_count == 0) {
+        app->config.scene_draw_count = 1;
+    }
 
     success = init_instance_(app);
 
@@ -206,33 +499,86 @@ bool init_vulkan_(vk_app* app) {
         setup_debug_messenger_(app);
     }
 
-    if(success) success &= create_surface_(app);
+    if(success && !app->config.headless) success &= create_surface_(app);
     if(success) success &= pick_physical_device_(app);
     if(success) success &= create_logical_device_(app);
-    if(success) success &= create_swapchain_(app);
+    if(success) {
+        init_gpu_allocator(&app->allocator, app->device, app->physical_device);
+        init_layout_cache(&app->layouts, app->device);
+    }
+    if(success) {
+        success &= init_bindless_table(&app->bindless, app->device,
+            app->physical_device, &app->layouts, BINDLESS_BUFFER_CAPACITY,
+            BINDLESS_TEXTURE_CAPACITY);
+    }
+    if(success) {
+        // Room for every draw even at the largest offset alignment
+        VkDeviceSize segment_size = UNIFORM_RING_SEGMENT_SIZE +
+            (VkDeviceSize)app->config.scene_draw_count * UNIFORM_BLOCK_MAX_SIZE;
+
+        success &= init_uniform_ring(&app->uniforms, app->device,
+            app->physical_device, &app->allocator, &app->layouts, segment_size,
+            app->config.frames_in_flight, UNIFORM_BLOCK_MAX_SIZE);
+    }
+    if(success) success &= create_frame_contexts_(app);
+    if(success) {
+        // A missing cache only costs compile time, so don't fail on it
+        app->pipeline_cache = load_pipeline_cache(app->device,
+            app->physical_device, PIPELINE_CACHE_PATH);
+    }
+    if(success) {
+        success &= init_pipeline_compiler(&app->pipelines, app->device,
+            app->pipeline_cache, app->config.compile_thread_count);
+    }
+    if(success) {
+        if(app->config.headless) {
+            success &= create_offscreen_targets_(app);
+        }
+        else {
+            success &= create_swapchain_(app);
+        }
+    }
     if(success) success &= create_image_views_(app);
-    if(success) success &= create_render_pass_(app);
+    if(success && !app->dynamic_rendering_enabled) {
+        success &= create_render_pass_(app);
+    }
     if(success) success &= create_graphics_pipeline_(app);
-    if(success) success &= create_framebuffers_(app);
-    if(success) success &= create_cmd_pool_(app);
+    if(success && !app->dynamic_rendering_enabled) {
+        success &= create_framebuffers_(app);
+    }
+    if(success) success &= create_cmd_pools_(app);
     if(success) success &= create_cmd_buffers_(app);
+    if(success) success &= create_scene_buffers_(app);
+    if(success) success &= create_compute_pass_(app);
+    if(success) success &= create_record_workers_(app);
     if(success) success &= create_sync_objects_(app);
+    if(success) success &= create_timestamp_queries_(app);
+    if(success && app->config.hot_reload) {
+        // Running without reload is still useful, so don't fail on it
+        app->hot_reload_enabled = init_hot_reload_(app);
+    }
 
     return success;
 }
 
 /**
  * Returns the extensions required for vulkan on this machine.
+ * Headless apps don't need any of the GLFW surface extensions.
  * 
  * Params:
+ *   app   - vulkan app
  *   count - Set to the total number of extensions
  * 
  * Returns:
  *   array of strings with length 'count'
  */
-char** get_required_extensions_(uint32_t* count) {
+char** get_required_extensions_(const vk_app* app, uint32_t* count) {
     uint32_t glfw_extensions_count = 0;
-    const char** glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extensions_count);
+    const char** glfw_extensions = NULL;
+
+    if(!app->config.headless) {
+        glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extensions_count);
+    }
 
     uint32_t total_count = glfw_extensions_count;
     char** exts = NULL;
@@ -278,11 +624,13 @@ bool init_instance_(vk_app* app) {
     app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     app_info.pEngineName = "No Engine";
     app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    app_info.apiVersion = VK_API_VERSION_1_0;
+    // 1.2 for timeline semaphores, which also covers
+    // vkGetPhysicalDeviceProperties2 used to read device UUIDs
+    app_info.apiVersion = VK_API_VERSION_1_2;
 
     // get required extensions
     uint32_t ext_count = 0;
-    char** required_exts = get_required_extensions_(&ext_count);
+    char** required_exts = get_required_extensions_(app, &ext_count);
 
     int all_layers_found = 0;
     if(ENABLE_VALIDATION_LAYERS) {
@@ -459,53 +807,274 @@ bool pick_physical_device_(vk_app* app) {
     VkPhysicalDevice* devices = (VkPhysicalDevice*)malloc(device_count * sizeof(VkPhysicalDevice));
     vkEnumeratePhysicalDevices(app->instance, &device_count, devices);
 
+    const char* override = app->config.device_override;
+    if(override != NULL && override[0] == '\0') {
+        override = NULL;
+    }
+
     printf("Found %i potential physical devices:\n", device_count);
-    bool found_valid_device = false;
+    uint64_t best_score = 0;
     for(uint32_t i = 0; i < device_count; i++) {
-        if(is_device_suitable_(devices[i], app->surface)) {
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(devices[i], &props);
+
+        uint8_t uuid[VK_UUID_SIZE] = {};
+        get_device_uuid_(devices[i], uuid);
+
+        bool suitable = is_device_suitable_(devices[i], app->surface);
+        uint64_t score = suitable ? score_device_(devices[i], app->surface) : 0;
+
+        printf("  - %s (%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x): ",
+            props.deviceName,
+            uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7],
+            uuid[8], uuid[9], uuid[10], uuid[11], uuid[12], uuid[13], uuid[14], uuid[15]);
+
+        if(!suitable) {
+            printf("unsuitable\n");
+            continue;
+        }
+        printf("score %llu\n", (unsigned long long)score);
+
+        if(override != NULL && !device_matches_override_(devices[i], override)) {
+            continue;
+        }
+
+        if(app->physical_device == VK_NULL_HANDLE || score > best_score) {
             app->physical_device = devices[i];
-            found_valid_device = true;
-            break;
+            best_score = score;
         }
     }
 
     free(devices);
     devices = NULL;
 
-    return found_valid_device;
+    if(app->physical_device == VK_NULL_HANDLE) {
+        if(override != NULL) {
+            fprintf(stderr, "No suitable physical device matches \"%s\"\n", override);
+        }
+        else {
+            fprintf(stderr, "No suitable physical device found\n");
+        }
+        return false;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(app->physical_device, &props);
+    printf("Using physical device %s\n", props.deviceName);
+
+    app->queue_topology = find_queue_families_(app->physical_device, app->surface);
+    printf("Queue families: graphics %i, present %i, transfer %i, compute %i\n",
+        app->queue_topology.graphics_family_index,
+        app->queue_topology.present_family_index,
+        app->queue_topology.transfer_family_index,
+        app->queue_topology.compute_family_index);
+
+    return true;
 }
 
 /**
- * Determines if a physical device meets our criteria.
+ * Ranks a suitable device. Device type dominates, then the size of
+ * the largest device-local heap, max 2D image size, queue topology
+ * and optional features break ties between devices of the same type.
  * 
  * Params:
- *   device - physical device
+ *   device  - physical device
+ *   surface - render surface, or VK_NULL_HANDLE
  * 
  * Returns:
- *   bool indicating validity
+ *   score, higher is better
  */
-bool is_device_suitable_(VkPhysicalDevice device, VkSurfaceKHR surface) {
+uint64_t score_device_(VkPhysicalDevice device, VkSurfaceKHR surface) {
     VkPhysicalDeviceProperties props;
     vkGetPhysicalDeviceProperties(device, &props);
 
     VkPhysicalDeviceFeatures features;
     vkGetPhysicalDeviceFeatures(device, &features);
 
-    bool valid = props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ||
-        VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU;
+    VkPhysicalDeviceMemoryProperties mem_props;
+    vkGetPhysicalDeviceMemoryProperties(device, &mem_props);
+
+    uint64_t score = 0;
+
+    // Far enough apart that everything below, capped as it is, can't
+    // make up for the type
+    switch(props.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            score += 4000000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            score += 3000000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            score += 2000000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            score += 1000000;
+            break;
+        default:
+            break;
+    }
+
+    // Largest device-local heap, in MiB
+    VkDeviceSize local_heap = 0;
+    for(uint32_t i = 0; i < mem_props.memoryHeapCount; i++) {
+        if((mem_props.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+                mem_props.memoryHeaps[i].size > local_heap) {
+            local_heap = mem_props.memoryHeaps[i].size;
+        }
+    }
+    VkDeviceSize local_heap_mib = local_heap / (1024 * 1024);
+    score += local_heap_mib < MAX_SCORED_HEAP_MIB ? local_heap_mib : MAX_SCORED_HEAP_MIB;
+
+    uint32_t image_dimension = props.limits.maxImageDimension2D;
+    score += (image_dimension < MAX_SCORED_IMAGE_DIMENSION ?
+        image_dimension : MAX_SCORED_IMAGE_DIMENSION) / 16;
+
+    // Queue topology: presenting from the graphics family avoids
+    // ownership transfers, separate transfer and compute families
+    // let uploads and compute overlap rendering
+    queue_families fams = find_queue_families_(device, surface);
+
+    if(fams.graphics_family_index == fams.present_family_index) score += 500;
+    if(fams.transfer_family_index != fams.graphics_family_index) score += 250;
+    if(fams.compute_family_index != fams.graphics_family_index) score += 250;
+
+    // Optional features
+    if(props.limits.timestampComputeAndGraphics) score += 100;
+    if(features.samplerAnisotropy) score += 50;
+
+    return score;
+}
+
+/**
+ * Reads the UUID of a device. Needs a Vulkan 1.1 device.
+ * 
+ * Params:
+ *   device - physical device
+ *   uuid   - receives VK_UUID_SIZE bytes
+ * 
+ * Returns:
+ *   false if the device is too old to report a UUID
+ */
+bool get_device_uuid_(VkPhysicalDevice device, uint8_t* uuid) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(device, &props);
+
+    if(props.apiVersion < VK_API_VERSION_1_1) {
+        return false;
+    }
+
+    VkPhysicalDeviceIDProperties id_props = {};
+    id_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 props2 = {};
+    props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props2.pNext = &id_props;
+
+    vkGetPhysicalDeviceProperties2(device, &props2);
+    memcpy(uuid, id_props.deviceUUID, VK_UUID_SIZE);
+
+    return true;
+}
+
+/**
+ * Checks a device against a user supplied override. An override of
+ * 32 hex digits (dashes ignored) is compared to the device UUID,
+ * anything else is a case insensitive substring of the device name.
+ * 
+ * Params:
+ *   device   - physical device
+ *   override - name or UUID
+ * 
+ * Returns:
+ *   bool indicating a match
+ */
+bool device_matches_override_(VkPhysicalDevice device, const char* override) {
+    uint8_t wanted[VK_UUID_SIZE];
+    uint32_t digits = 0;
+    bool is_uuid = true;
+
+    for(const char* c = override; *c != '\0' && is_uuid; c++) {
+        if(*c == '-') {
+            continue;
+        }
+
+        int value = -1;
+        if(*c >= '0' && *c <= '9') value = *c - '0';
+        else if(*c >= 'a' && *c <= 'f') value = *c - 'a' + 10;
+        else if(*c >= 'A' && *c <= 'F') value = *c - 'A' + 10;
+
+        if(value < 0 || digits >= VK_UUID_SIZE * 2) {
+            is_uuid = false;
+        }
+        else {
+            if(digits % 2 == 0) {
+                wanted[digits / 2] = (uint8_t)(value << 4);
+            }
+            else {
+                wanted[digits / 2] |= (uint8_t)value;
+            }
+            digits++;
+        }
+    }
+    is_uuid &= digits == VK_UUID_SIZE * 2;
+
+    if(is_uuid) {
+        uint8_t uuid[VK_UUID_SIZE];
+        return get_device_uuid_(device, uuid) &&
+            memcmp(uuid, wanted, VK_UUID_SIZE) == 0;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(device, &props);
+
+    size_t name_len = strlen(props.deviceName);
+    size_t override_len = strlen(override);
+
+    for(size_t start = 0; start + override_len <= name_len; start++) {
+        size_t i = 0;
+        while(i < override_len &&
+                tolower((unsigned char)props.deviceName[start + i]) ==
+                tolower((unsigned char)override[i])) {
+            i++;
+        }
+
+        if(i == override_len) {
+            return true;
+        }
+    }
+
+    return false;
+}
 
+/**
+ * Determines if a physical device meets our criteria. When surface
+ * is VK_NULL_HANDLE (headless) presentation support isn't required.
+ * 
+ * Params:
+ *   device  - physical device
+ *   surface - render surface, or VK_NULL_HANDLE
+ * 
+ * Returns:
+ *   bool indicating validity
+ */
+bool is_device_suitable_(VkPhysicalDevice device, VkSurfaceKHR surface) {
+    // Any device type will do, score_device_ decides which is best
     queue_families families = find_queue_families_(device, surface);
+    bool valid = families.is_complete && device_supports_timelines_(device) &&
+        device_supports_bindless_(device);
 
-    valid &= device_supports_exts_(device);
-    valid &= families.is_complete;
+    if(surface != VK_NULL_HANDLE) {
+        valid &= device_supports_exts_(device);
+    }
 
-    if(valid) {
+    if(valid && surface != VK_NULL_HANDLE) {
         swapchain_details scd = get_swapchain_support_(device, surface);
 
         valid &= (scd.num_formats != 0 && scd.num_present_modes != 0);
-    }
 
-    printf("  - Checking device %s - %i\n", props.deviceName, valid);
+        cleanup_swapchain_details(&scd);
+    }
 
     return valid;
 }
@@ -553,65 +1122,286 @@ bool device_supports_exts_(VkPhysicalDevice device) {
 }
 
 /**
- * Selects appropriate queue families for the given
- * physical device.
+ * Checks if the given device is Vulkan 1.2 and supports timeline
+ * semaphores, which the frame clock is built on.
  * 
  * Params:
- *   device - physical device
+ *   device - Physical device handle.
  * 
  * Returns:
- *   queue_families struct containing family indices.
+ *   boolean indicating support
  */
-queue_families find_queue_families_(
-        VkPhysicalDevice device,
-        VkSurfaceKHR surface
-        ) {
-    queue_families indices = {
-        -1,     // graphics family index
-        -1,     // present family index
-        false   // is complete
-    };
-
-    uint32_t family_count = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, NULL);
-
-    VkQueueFamilyProperties* families = (VkQueueFamilyProperties*)malloc(
-            family_count * sizeof(VkQueueFamilyProperties));
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families);
+bool device_supports_timelines_(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(device, &props);
 
-    printf("  - Found %i queue families\n", family_count);
-    for(uint32_t i = 0; i < family_count; i++) {
-        printf("    - Family %i has: %i queues, ", i, families[i].queueCount);
+    if(props.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
 
-        if(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            printf("graphics bit, ");
+    VkPhysicalDeviceVulkan12Features features_12 = {};
+    features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 
-            if(indices.graphics_family_index == -1) {
-                indices.graphics_family_index = i;
-            }
-        }
-        else {
-            printf("no graphics bit, ");
-        }
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features_12;
 
-        VkBool32 present_support = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support);
+    vkGetPhysicalDeviceFeatures2(device, &features);
 
-        if(present_support == VK_TRUE) {
-            indices.present_family_index = i;
-            printf("presentation support\n");
-        }
-        else {
-            printf("no presentation support\n");
-        }
+    return features_12.timelineSemaphore == VK_TRUE;
+}
 
-        if(indices.graphics_family_index != -1 && 
-                indices.present_family_index != -1) {
-            indices.is_complete = true;
-            break;
+/**
+ * Checks if the given device supports the descriptor indexing
+ * features the bindless table is built on. Only called for Vulkan
+ * 1.2 devices, where they are part of the core features.
+ * 
+ * Params:
+ *   device - Physical device handle.
+ * 
+ * Returns:
+ *   boolean indicating support
+ */
+bool device_supports_bindless_(VkPhysicalDevice device) {
+    VkPhysicalDeviceVulkan12Features features_12 = {};
+    features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features_12;
+
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    // Shaders index the arrays with push constant values
+    return features.features.shaderStorageBufferArrayDynamicIndexing == VK_TRUE &&
+        features.features.shaderSampledImageArrayDynamicIndexing == VK_TRUE &&
+        features_12.descriptorIndexing == VK_TRUE &&
+        features_12.runtimeDescriptorArray == VK_TRUE &&
+        features_12.descriptorBindingPartiallyBound == VK_TRUE &&
+        features_12.descriptorBindingVariableDescriptorCount == VK_TRUE &&
+        features_12.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+        features_12.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+        features_12.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+        features_12.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+}
+
+/**
+ * Checks if the given device supports a single device extension.
+ * 
+ * Params:
+ *   device - Physical device handle.
+ *   name   - extension name
+ * 
+ * Returns:
+ *   boolean indicating support
+ */
+bool device_has_extension_(VkPhysicalDevice device, const char* name) {
+    uint32_t ext_count = 0;
+    vkEnumerateDeviceExtensionProperties(device, NULL, &ext_count, NULL);
+
+    VkExtensionProperties* props = (VkExtensionProperties*)malloc(
+            sizeof(VkExtensionProperties) * ext_count);
+    vkEnumerateDeviceExtensionProperties(device, NULL, &ext_count, props);
+
+    bool found = false;
+    for(uint32_t i = 0; i < ext_count && !found; i++) {
+        found = strcmp(name, props[i].extensionName) == 0;
+    }
+
+    free(props);
+    return found;
+}
+
+/**
+ * Checks if the given device can tag presents with IDs and wait on
+ * them, which low latency mode is built on.
+ * 
+ * Params:
+ *   device - Physical device handle.
+ * 
+ * Returns:
+ *   boolean indicating support
+ */
+bool device_supports_present_wait_(VkPhysicalDevice device) {
+    if(!device_has_extension_(device, VK_KHR_PRESENT_ID_EXTENSION_NAME) ||
+            !device_has_extension_(device, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        return false;
+    }
+
+    VkPhysicalDevicePresentWaitFeaturesKHR wait_features = {};
+    wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+    VkPhysicalDevicePresentIdFeaturesKHR id_features = {};
+    id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    id_features.pNext = &wait_features;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &id_features;
+
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return id_features.presentId == VK_TRUE && wait_features.presentWait == VK_TRUE;
+}
+
+/**
+ * Checks if the given device can render without render pass and
+ * framebuffer objects.
+ * 
+ * Params:
+ *   device - Physical device handle.
+ * 
+ * Returns:
+ *   boolean indicating support
+ */
+bool device_supports_dynamic_rendering_(VkPhysicalDevice device) {
+    if(!device_has_extension_(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+        return false;
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR rendering_features = {};
+    rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &rendering_features;
+
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return rendering_features.dynamicRendering == VK_TRUE;
+}
+
+/**
+ * Finds out which extended dynamic state tiers the given device
+ * supports. Only polygon mode is used out of the third tier.
+ * 
+ * Params:
+ *   device - Physical device handle.
+ *   table  - receives the supported tiers, entry points are cleared
+ */
+void query_extended_dynamic_state_(VkPhysicalDevice device,
+        dynamic_state_table* table) {
+    memset(table, 0, sizeof(dynamic_state_table));
+
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT features_1 = {};
+    features_1.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT features_2 = {};
+    features_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+    features_2.pNext = &features_1;
+
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT features_3 = {};
+    features_3.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    features_3.pNext = &features_2;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features_3;
+
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    table->extended =
+        device_has_extension_(device, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) &&
+        features_1.extendedDynamicState == VK_TRUE;
+    table->extended_2 =
+        device_has_extension_(device, VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME) &&
+        features_2.extendedDynamicState2 == VK_TRUE;
+    table->polygon_mode =
+        device_has_extension_(device, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME) &&
+        features_3.extendedDynamicState3PolygonMode == VK_TRUE;
+}
+
+/**
+ * Resolves the queue topology of the given physical device.
+ * A single family that can both draw and present is preferred so
+ * swapchain images stay exclusive to it. Without a surface the
+ * graphics family doubles as the present family.
+ * 
+ * Params:
+ *   device  - physical device
+ *   surface - render surface, or VK_NULL_HANDLE
+ * 
+ * Returns:
+ *   queue_families struct containing family indices.
+ */
+queue_families find_queue_families_(
+        VkPhysicalDevice device,
+        VkSurfaceKHR surface
+        ) {
+    queue_families indices = {
+        -1,     // graphics family index
+        -1,     // present family index
+        -1,     // transfer family index
+        -1,     // compute family index
+        false   // is complete
+    };
+
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, NULL);
+
+    VkQueueFamilyProperties* families = (VkQueueFamilyProperties*)malloc(
+            family_count * sizeof(VkQueueFamilyProperties));
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &family_count, families);
+
+    for(int32_t i = 0; i < (int32_t)family_count; i++) {
+        VkQueueFlags flags = families[i].queueFlags;
+        bool graphics = (flags & VK_QUEUE_GRAPHICS_BIT) != 0;
+
+        VkBool32 present_support = VK_FALSE;
+        if(surface != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support);
+        }
+        else {
+            // Nothing to present to, so any graphics family will do
+            present_support = graphics ? VK_TRUE : VK_FALSE;
+        }
+
+        if(graphics && present_support) {
+            bool had_shared = indices.graphics_family_index != -1 &&
+                indices.graphics_family_index == indices.present_family_index;
+
+            if(!had_shared) {
+                indices.graphics_family_index = i;
+                indices.present_family_index = i;
+            }
+        }
+        else if(graphics && indices.graphics_family_index == -1) {
+            indices.graphics_family_index = i;
+        }
+        else if(present_support && indices.present_family_index == -1) {
+            indices.present_family_index = i;
+        }
+
+        // Graphics and compute families implicitly support transfers
+        if(!graphics && (flags & VK_QUEUE_COMPUTE_BIT)) {
+            if(indices.compute_family_index == -1) {
+                indices.compute_family_index = i;
+            }
+        }
+        else if(!graphics && (flags & VK_QUEUE_TRANSFER_BIT)) {
+            if(indices.transfer_family_index == -1) {
+                indices.transfer_family_index = i;
+            }
         }
     }
 
+    free(families);
+
+    // Without dedicated families, fall back to an async compute family
+    // for transfers and to the graphics family for both
+    if(indices.transfer_family_index == -1) {
+        indices.transfer_family_index = indices.compute_family_index;
+    }
+    if(indices.compute_family_index == -1) {
+        indices.compute_family_index = indices.graphics_family_index;
+    }
+    if(indices.transfer_family_index == -1) {
+        indices.transfer_family_index = indices.graphics_family_index;
+    }
+
+    indices.is_complete = indices.graphics_family_index != -1 &&
+        indices.present_family_index != -1;
+
     return indices;
 }
 
@@ -685,48 +1475,92 @@ VkSurfaceFormatKHR choose_swap_surface_format_(
 }
 
 /**
- * Searches through the available present modes to find
- * an ideal one.
+ * Picks the preferred present mode if the surface supports it.
+ * FIFO is the fallback, every surface has to support it.
  * 
  * Params:
  *   present_modes - array of available present modes
  *   num_present_modes - number of modes
+ *   preferred - mode asked for in the app config
  * 
  * Returns:
  *   Chosen VkPresentModeKHR
  */
 VkPresentModeKHR choose_present_mode_(
         VkPresentModeKHR* present_modes,
-        uint32_t num_present_modes
+        uint32_t num_present_modes,
+        VkPresentModeKHR preferred
         ) {
     for(uint32_t i = 0; i < num_present_modes; i++) {
-        if(present_modes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
-            printf("Found desired mailbox present mode\n");
+        if(present_modes[i] == preferred) {
+            printf("Found desired %s present mode\n", present_mode_name(preferred));
             return present_modes[i];
         }
     }
 
-    printf("Desired present mode not found. Defaulting to FIFO\n");
+    printf("Desired %s present mode not found. Defaulting to FIFO\n",
+        present_mode_name(preferred));
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+/**
+ * Picks how many swapchain images to request. One more than the
+ * minimum lets the app acquire while the presentation engine holds
+ * the rest, but a different count can be configured.
+ * 
+ * Params:
+ *   capabilities - surface capabilities
+ *   requested    - configured image count, 0 for the default
+ * 
+ * Returns:
+ *   image count within the surface's limits
+ */
+uint32_t choose_swap_image_count_(const VkSurfaceCapabilitiesKHR* capabilities,
+        uint32_t requested) {
+    uint32_t img_count = requested;
+    if(img_count == 0) {
+        img_count = capabilities->minImageCount + 1;
+    }
+
+    if(img_count < capabilities->minImageCount) {
+        img_count = capabilities->minImageCount;
+        printf("Below min image count. Using %i\n", img_count);
+    }
+    else if(capabilities->maxImageCount > 0 && img_count > capabilities->maxImageCount) {
+        img_count = capabilities->maxImageCount;
+        printf("Exceeded max image count. Using %i\n", img_count);
+    }
+    else {
+        printf("Requesting %i swapchain images\n", img_count);
+    }
+
+    return img_count;
+}
+
 /**
  * Selects the idea swap extent.
  * 
  * Params:
+ *   window       - window being presented to
  *   capabilities - surface capabilities
  * 
  * Retruns:
  *   Chosen VkExtent2D
  */
-VkExtent2D choose_swap_extent_(const VkSurfaceCapabilitiesKHR* const capabilities) {
+VkExtent2D choose_swap_extent_(GLFWwindow* window,
+        const VkSurfaceCapabilitiesKHR* const capabilities) {
 
     // If extent width is set to max, we can do what we want.
     if(capabilities->currentExtent.width != UINT32_MAX) {
         return capabilities->currentExtent;
     }
     else {
-        VkExtent2D actual_extent = { WIDTH, HEIGHT };
+        // Window size is in screen coordinates, we want pixels
+        int width = 0;
+        int height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+
+        VkExtent2D actual_extent = { (uint32_t)width, (uint32_t)height };
 
         actual_extent.width = fmax(capabilities->minImageExtent.width,
                 fmin(capabilities->maxImageExtent.width, actual_extent.width));
@@ -747,45 +1581,148 @@ VkExtent2D choose_swap_extent_(const VkSurfaceCapabilitiesKHR* const capabilitie
  *   bool indicating success.
  */
 bool create_logical_device_(vk_app* app) {
-    queue_families indices = find_queue_families_(app->physical_device, app->surface);
+    const queue_families* indices = &app->queue_topology;
+
+    // One queue from every distinct family in the topology
+    int32_t wanted_families[] = {
+        indices->graphics_family_index,
+        indices->present_family_index,
+        indices->transfer_family_index,
+        indices->compute_family_index
+    };
 
     float queue_priority = 1.0f; 
-    VkDeviceQueueCreateInfo graphics_info = {};
-    graphics_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    graphics_info.queueFamilyIndex = indices.graphics_family_index;
-    graphics_info.queueCount = 1;
-    graphics_info.pQueuePriorities = &queue_priority;
-
-    VkDeviceQueueCreateInfo present_info = {};
-    present_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    present_info.queueFamilyIndex = indices.present_family_index;
-    present_info.queueCount = 1;
-    present_info.pQueuePriorities = &queue_priority;
-
-    VkDeviceQueueCreateInfo queue_infos[] = {
-        graphics_info,
-        present_info
-    };
+    VkDeviceQueueCreateInfo queue_infos[4];
+    uint32_t queue_create_count = 0;
+
+    for(uint32_t i = 0; i < 4; i++) {
+        bool seen = false;
+        for(uint32_t j = 0; j < queue_create_count; j++) {
+            seen |= queue_infos[j].queueFamilyIndex == (uint32_t)wanted_families[i];
+        }
+
+        if(!seen) {
+            VkDeviceQueueCreateInfo queue_info = {};
+            queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queue_info.queueFamilyIndex = wanted_families[i];
+            queue_info.queueCount = 1;
+            queue_info.pQueuePriorities = &queue_priority;
+
+            queue_infos[queue_create_count++] = queue_info;
+        }
+    }
 
-    // don't need anything special, leave default
+    // Bindless shaders index the table's arrays dynamically, checked
+    // by is_device_suitable_
     VkPhysicalDeviceFeatures device_features = {};
-    uint32_t queue_create_count = 0;
+    device_features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    device_features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
+    // Checked by is_device_suitable_
+    VkPhysicalDeviceVulkan12Features features_12 = {};
+    features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features_12.timelineSemaphore = VK_TRUE;
+
+    // Descriptor indexing for the bindless table
+    features_12.descriptorIndexing = VK_TRUE;
+    features_12.runtimeDescriptorArray = VK_TRUE;
+    features_12.descriptorBindingPartiallyBound = VK_TRUE;
+    features_12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    features_12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features_12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features_12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features_12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+    // Required extensions first, optional ones are appended when
+    // the device supports them. Headless rendering doesn't need the
+    // swapchain extension.
+    const char* extensions[MAX_DEVICE_EXTENSIONS];
+    uint32_t extension_count = 0;
+
+    if(!app->config.headless) {
+        for(uint32_t i = 0; i < DEVICE_EXTENSIONS_COUNT; i++) {
+            extensions[extension_count++] = DEVICE_EXTENSIONS[i];
+        }
+    }
+
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features = {};
+    present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    present_id_features.presentId = VK_TRUE;
+
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = {};
+    present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    present_wait_features.presentWait = VK_TRUE;
+    present_wait_features.pNext = &present_id_features;
+
+    app->present_wait_enabled = false;
+    if(!app->config.headless && app->config.low_latency) {
+        if(device_supports_present_wait_(app->physical_device)) {
+            extensions[extension_count++] = VK_KHR_PRESENT_ID_EXTENSION_NAME;
+            extensions[extension_count++] = VK_KHR_PRESENT_WAIT_EXTENSION_NAME;
+
+            present_id_features.pNext = features_12.pNext;
+            features_12.pNext = &present_wait_features;
+            app->present_wait_enabled = true;
+        }
+        else {
+            printf("Device lacks present wait, low latency mode disabled\n");
+        }
+    }
 
-    if(indices.graphics_family_index != indices.present_family_index) {
-        queue_create_count = 2;
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR rendering_features = {};
+    rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    rendering_features.dynamicRendering = VK_TRUE;
+
+    app->dynamic_rendering_enabled = false;
+    if(app->config.dynamic_rendering &&
+            device_supports_dynamic_rendering_(app->physical_device)) {
+        extensions[extension_count++] = VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME;
+
+        rendering_features.pNext = features_12.pNext;
+        features_12.pNext = &rendering_features;
+        app->dynamic_rendering_enabled = true;
     }
-    else {
-        queue_create_count = 1;
+
+    // Every supported extended dynamic state tier is enabled, the
+    // pipeline bakes in whatever is left
+    query_extended_dynamic_state_(app->physical_device, &app->dynamic_state);
+
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT dynamic_features_1 = {};
+    dynamic_features_1.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    dynamic_features_1.extendedDynamicState = VK_TRUE;
+
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT dynamic_features_2 = {};
+    dynamic_features_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+    dynamic_features_2.extendedDynamicState2 = VK_TRUE;
+
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamic_features_3 = {};
+    dynamic_features_3.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    dynamic_features_3.extendedDynamicState3PolygonMode = VK_TRUE;
+
+    if(app->dynamic_state.extended) {
+        extensions[extension_count++] = VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME;
+        dynamic_features_1.pNext = features_12.pNext;
+        features_12.pNext = &dynamic_features_1;
+    }
+    if(app->dynamic_state.extended_2) {
+        extensions[extension_count++] = VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME;
+        dynamic_features_2.pNext = features_12.pNext;
+        features_12.pNext = &dynamic_features_2;
+    }
+    if(app->dynamic_state.polygon_mode) {
+        extensions[extension_count++] = VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME;
+        dynamic_features_3.pNext = features_12.pNext;
+        features_12.pNext = &dynamic_features_3;
     }
 
     VkDeviceCreateInfo device_create_info = {};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.pNext = &features_12;
     device_create_info.pQueueCreateInfos = queue_infos;
     device_create_info.queueCreateInfoCount = queue_create_count;
     device_create_info.pEnabledFeatures = &device_features;    
-
-    device_create_info.enabledExtensionCount = DEVICE_EXTENSIONS_COUNT;
-    device_create_info.ppEnabledExtensionNames = DEVICE_EXTENSIONS;
+    device_create_info.enabledExtensionCount = extension_count;
+    device_create_info.ppEnabledExtensionNames = extension_count > 0 ? extensions : NULL;
 
     // These are deprecated, but set for outdated implementations
     if(ENABLE_VALIDATION_LAYERS) {
@@ -801,12 +1738,43 @@ bool create_logical_device_(vk_app* app) {
 
     if(success != VK_SUCCESS) {
         fprintf(stderr, "Unable to create logical device\n");
+        return false;
     }
 
-    vkGetDeviceQueue(app->device, indices.graphics_family_index, 0, &app->graphics_queue);
-    vkGetDeviceQueue(app->device, indices.present_family_index, 0, &app->present_queue);
+    if(app->present_wait_enabled) {
+        app->wait_for_present = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(
+            app->device, "vkWaitForPresentKHR");
+        app->present_wait_enabled = app->wait_for_present != NULL;
+    }
+
+    if(app->present_wait_enabled) {
+        printf("Low latency presentation enabled\n");
+    }
+
+    if(app->dynamic_rendering_enabled) {
+        app->cmd_begin_rendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(
+            app->device, "vkCmdBeginRenderingKHR");
+        app->cmd_end_rendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(
+            app->device, "vkCmdEndRenderingKHR");
+        app->dynamic_rendering_enabled = app->cmd_begin_rendering != NULL &&
+            app->cmd_end_rendering != NULL;
+    }
+
+    printf("Rendering with %s\n",
+        app->dynamic_rendering_enabled ? "dynamic rendering" : "a render pass");
+
+    load_dynamic_state_table(app->device, &app->dynamic_state);
+    printf("Extended dynamic state: %s, 2: %s, 3 polygon mode: %s\n",
+        app->dynamic_state.extended ? "yes" : "no",
+        app->dynamic_state.extended_2 ? "yes" : "no",
+        app->dynamic_state.polygon_mode ? "yes" : "no");
+
+    vkGetDeviceQueue(app->device, indices->graphics_family_index, 0, &app->graphics_queue);
+    vkGetDeviceQueue(app->device, indices->present_family_index, 0, &app->present_queue);
+    vkGetDeviceQueue(app->device, indices->transfer_family_index, 0, &app->transfer_queue);
+    vkGetDeviceQueue(app->device, indices->compute_family_index, 0, &app->compute_queue);
 
-    return success == VK_SUCCESS;
+    return true;
 }
 
 /**
@@ -824,17 +1792,11 @@ bool create_swapchain_(vk_app* app) {
     app->swapchain_format = choose_swap_surface_format_(
             scd.formats, scd.num_formats);
     VkPresentModeKHR present_mode = choose_present_mode_(
-            scd.present_modes, scd.num_present_modes);
-    app->swapchain_extent = choose_swap_extent_(&scd.capabilities);
+            scd.present_modes, scd.num_present_modes, app->config.present_mode);
+    app->swapchain_extent = choose_swap_extent_(app->app_window, &scd.capabilities);
 
-    uint32_t img_count = scd.capabilities.minImageCount + 1;
-    if(scd.capabilities.maxImageCount > 0 && img_count > scd.capabilities.maxImageCount) {
-        img_count = scd.capabilities.maxImageCount;
-        printf("Exceeded max image count. Using %i\n", img_count);
-    }
-    else {
-        printf("No max image count found. Using %i\n", img_count);
-    }
+    uint32_t img_count = choose_swap_image_count_(&scd.capabilities,
+            app->config.swapchain_image_count);
 
     VkSwapchainCreateInfoKHR create_info = {};
     create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -846,15 +1808,14 @@ bool create_swapchain_(vk_app* app) {
     create_info.imageArrayLayers = 1;
     create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-    queue_families indices = find_queue_families_(app->physical_device,
-            app->surface);
+    const queue_families* indices = &app->queue_topology;
     uint32_t queue_fam_indices[] = {
-        indices.graphics_family_index,
-        indices.present_family_index
+        indices->graphics_family_index,
+        indices->present_family_index
     };
 
     // If using 2 different families, need to make sharing concurrent
-    if(indices.graphics_family_index != indices.present_family_index) {
+    if(indices->graphics_family_index != indices->present_family_index) {
         create_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
         create_info.queueFamilyIndexCount = 2;
         create_info.pQueueFamilyIndices = queue_fam_indices;
@@ -869,107 +1830,279 @@ bool create_swapchain_(vk_app* app) {
     create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     create_info.presentMode = present_mode;
     create_info.clipped = VK_TRUE;
-    create_info.oldSwapchain = VK_NULL_HANDLE;
+
+    // Handing over the old swapchain lets the driver recycle its images
+    VkSwapchainKHR old_swapchain = app->swapchain;
+    create_info.oldSwapchain = old_swapchain;
 
     VkResult result = vkCreateSwapchainKHR(app->device,
             &create_info, NULL, &app->swapchain);
 
+    cleanup_swapchain_details(&scd);
+
+    if(old_swapchain != VK_NULL_HANDLE) {
+        // Retired either way, even if creating the new one failed
+        vkDestroySwapchainKHR(app->device, old_swapchain, NULL);
+    }
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to create swapchain\n");
+        app->swapchain = VK_NULL_HANDLE;
+    }
+
     if(result == VK_SUCCESS) {
         result = vkGetSwapchainImagesKHR(app->device, app->swapchain,
                 &app->swapchain_image_count, NULL);
 
         printf("Swapchain has %i images\n", app->swapchain_image_count);
-        if(app->swapchain_image_count > 0) {
-            app->swapchain_images = malloc(
-                    sizeof(VkImage) * app->swapchain_image_count
-                    );
-
-            result = vkGetSwapchainImagesKHR(
-                    app->device,
-                    app->swapchain,
-                    &app->swapchain_image_count,
-                    app->swapchain_images
-                    );
+
+        // Fresh entries, nothing is in flight on a new swapchain
+        free(app->swapchain_images);
+        app->swapchain_images = (swapchain_image*)calloc(
+                app->swapchain_image_count, sizeof(swapchain_image));
+
+        VkImage* images = (VkImage*)malloc(
+                sizeof(VkImage) * app->swapchain_image_count);
+
+        result = vkGetSwapchainImagesKHR(
+                app->device,
+                app->swapchain,
+                &app->swapchain_image_count,
+                images
+                );
+
+        for(uint32_t i = 0; i < app->swapchain_image_count; i++) {
+            app->swapchain_images[i].image = images[i];
         }
+        free(images);
     }
 
     return result == VK_SUCCESS;
 }
 
 /**
- * Creates image views to be used in the render pipeline.
+ * Rebuilds the swapchain and everything that depends on its images
+ * or extent after a resize or VK_ERROR_OUT_OF_DATE_KHR. The device,
+ * pipeline cache, command pools and sync objects are kept, and the
+ * old swapchain is passed through oldSwapchain so its images can be
+ * recycled.
  * 
  * Params:
- *   app - Vulkan app
+ *   app - vulkan app
  * 
  * Returns:
- *   boolean indicating success
+ *   bool indicating success.
  */
-bool create_image_views_(vk_app* app) {
+bool recreate_swapchain_(vk_app* app) {
+    // A minimized window has a zero sized framebuffer, wait it out
+    int width = 0;
+    int height = 0;
+    glfwGetFramebufferSize(app->app_window, &width, &height);
+    while((width == 0 || height == 0) && !glfwWindowShouldClose(app->app_window)) {
+        glfwWaitEvents();
+        glfwGetFramebufferSize(app->app_window, &width, &height);
+    }
 
-    app->swapchain_image_views = (VkImageView*)malloc(
-            sizeof(VkImageView) * app->swapchain_image_count
-            );
+    // Old views and framebuffers may still be referenced by queued frames
+    vkDeviceWaitIdle(app->device);
 
-    bool success = true;
-    for(uint32_t i = 0; i < app->swapchain_image_count; i++) {
-        VkImageViewCreateInfo create_info = {};
+    cleanup_swapchain_(app);
 
-        create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        create_info.image = app->swapchain_images[i];
-        create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        create_info.format = app->swapchain_format.format;
+    VkFormat old_format = app->swapchain_format.format;
 
-        // default color mapping
-        create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-        create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-        create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-        create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    bool success = create_swapchain_(app);
+    if(success) success &= create_image_views_(app);
 
-        create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        create_info.subresourceRange.baseMipLevel = 0;
-        create_info.subresourceRange.levelCount = 1;
-        create_info.subresourceRange.baseArrayLayer = 0;
-        create_info.subresourceRange.layerCount = 1;
+    // Present IDs are per swapchain, there is nothing to wait for yet
+    app->present_id = 0;
+    app->waited_present_id = 0;
 
-        VkResult result = vkCreateImageView(
-                app->device,
-                &create_info,
-                NULL,
-                &app->swapchain_image_views[i]
-                );
+    // The render pass and pipeline only depend on the format, which
+    // rarely changes. Viewport and scissor are dynamic.
+    bool render_pass = !app->dynamic_rendering_enabled;
+    if(success && app->swapchain_format.format != old_format) {
+        destroy_graphics_pipeline_(app);
 
-        success &= (result == VK_SUCCESS);
+        if(render_pass) {
+            vkDestroyRenderPass(app->device, app->render_pass, NULL);
+            success &= create_render_pass_(app);
+        }
+
+        if(success) success &= create_graphics_pipeline_(app);
     }
 
+    if(success && render_pass) success &= create_framebuffers_(app);
+
     if(success) {
-        printf("Succesfully created image views\n");
+        printf("Recreated swapchain at %ix%i\n",
+            app->swapchain_extent.width, app->swapchain_extent.height);
     }
     else {
-        fprintf(stderr, "Failed to create one or more image views\n");
+        fprintf(stderr, "Unable to recreate swapchain\n");
     }
 
     return success;
 }
 
-bool create_render_pass_(vk_app* app) {
-    VkAttachmentDescription color_attachment = {};
-    color_attachment.format = app->swapchain_format.format;
-    color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+/**
+ * Destroys the objects that have to be rebuilt with the swapchain.
+ * The swapchain itself is kept so it can be handed to
+ * create_swapchain_ as the old swapchain.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void cleanup_swapchain_(vk_app* app) {
+    for(uint32_t i = 0; i < app->swapchain_image_count; i++) {
+        vkDestroyFramebuffer(app->device, app->swapchain_images[i].framebuffer, NULL);
+        app->swapchain_images[i].framebuffer = VK_NULL_HANDLE;
+    }
 
-    // This references the layout(location = 0) out vec4 outColor in shader
-    VkAttachmentReference color_attachment_ref = {};
-    color_attachment_ref.attachment = 0;
-    color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    for(uint32_t i = 0; i < app->swapchain_image_count; i++) {
+        vkDestroyImageView(app->device, app->swapchain_images[i].view, NULL);
+        app->swapchain_images[i].view = VK_NULL_HANDLE;
+    }
+}
 
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+/**
+ * Creates the device-local images that stand in for swapchain
+ * images when running headless. One target is created per frame
+ * in flight so consecutive frames never wait on each other's image.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   bool indicating success.
+ */
+bool create_offscreen_targets_(vk_app* app) {
+    app->swapchain_format.format = VK_FORMAT_B8G8R8A8_SRGB;
+    app->swapchain_format.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    app->swapchain_extent.width = app->config.width;
+    app->swapchain_extent.height = app->config.height;
+    app->swapchain = VK_NULL_HANDLE;
+
+    app->swapchain_image_count = app->config.frames_in_flight;
+    app->swapchain_images = (swapchain_image*)calloc(
+            app->swapchain_image_count, sizeof(swapchain_image));
+
+    VkResult result = VK_SUCCESS;
+
+    for(uint32_t i = 0; i < app->swapchain_image_count && result == VK_SUCCESS; i++) {
+        VkImageCreateInfo img_info = {};
+        img_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        img_info.imageType = VK_IMAGE_TYPE_2D;
+        img_info.format = app->swapchain_format.format;
+        img_info.extent.width = app->swapchain_extent.width;
+        img_info.extent.height = app->swapchain_extent.height;
+        img_info.extent.depth = 1;
+        img_info.mipLevels = 1;
+        img_info.arrayLayers = 1;
+        img_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        img_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        img_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        img_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        img_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        result = vkCreateImage(app->device, &img_info, NULL,
+                &app->swapchain_images[i].image);
+
+        if(result != VK_SUCCESS) {
+            fprintf(stderr, "Unable to create offscreen image %i\n", i);
+            break;
+        }
+
+        if(!gpu_allocate_image_memory(&app->allocator, app->swapchain_images[i].image,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &app->swapchain_images[i].memory)) {
+            fprintf(stderr, "Unable to back offscreen image %i with memory\n", i);
+            result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+    }
+
+    if(result == VK_SUCCESS) {
+        printf("Created %i offscreen render targets\n", app->swapchain_image_count);
+    }
+
+    return result == VK_SUCCESS;
+}
+
+/**
+ * Creates image views to be used in the render pipeline.
+ * 
+ * Params:
+ *   app - Vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool create_image_views_(vk_app* app) {
+    bool success = true;
+    for(uint32_t i = 0; i < app->swapchain_image_count; i++) {
+        VkImageViewCreateInfo create_info = {};
+
+        create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        create_info.image = app->swapchain_images[i].image;
+        create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        create_info.format = app->swapchain_format.format;
+
+        // default color mapping
+        create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+        create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        create_info.subresourceRange.baseMipLevel = 0;
+        create_info.subresourceRange.levelCount = 1;
+        create_info.subresourceRange.baseArrayLayer = 0;
+        create_info.subresourceRange.layerCount = 1;
+
+        VkResult result = vkCreateImageView(
+                app->device,
+                &create_info,
+                NULL,
+                &app->swapchain_images[i].view
+                );
+
+        success &= (result == VK_SUCCESS);
+    }
+
+    if(success) {
+        printf("Succesfully created image views\n");
+    }
+    else {
+        fprintf(stderr, "Failed to create one or more image views\n");
+    }
+
+    return success;
+}
+
+bool create_render_pass_(vk_app* app) {
+    VkAttachmentDescription color_attachment = {};
+    color_attachment.format = app->swapchain_format.format;
+    color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    // Offscreen targets are never presented, leave them ready for readback
+    if(app->config.headless) {
+        color_attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    }
+    else {
+        color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    }
+
+    // This references the layout(location = 0) out vec4 outColor in shader
+    VkAttachmentReference color_attachment_ref = {};
+    color_attachment_ref.attachment = 0;
+    color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &color_attachment_ref;
 
@@ -998,199 +2131,161 @@ bool create_render_pass_(vk_app* app) {
     return result == VK_SUCCESS;    
 }
 
-bool create_graphics_pipeline_(vk_app* app) {
+/**
+ * Swaps the application-defined sets into a reflected layout: the
+ * bindless table at BINDLESS_SET and the uniform ring at
+ * UNIFORM_RING_SET.
+ * 
+ * Params:
+ *   app  - vulkan app
+ *   desc - merged interface of a pipeline's stages
+ * 
+ * Returns:
+ *   false if the shaders' declarations don't match those sets
+ */
+bool patch_pipeline_layout_(vk_app* app, pipeline_layout_desc* desc) {
+    return bindless_patch_layout(&app->bindless, desc) &&
+        uniform_ring_patch_layout(&app->uniforms, desc);
+}
 
-    size_t vert_size;
-    uint32_t* vert_code = read_file("vert.spv", &vert_size);
+/**
+ * Derives a pipeline layout from the reflected stages of a pipeline,
+ * with the application-defined sets patched in. Pipelines whose
+ * shaders have the same interface get the same layout.
+ * 
+ * Params:
+ *   app         - vulkan app
+ *   stages      - reflected stages
+ *   stage_count - number of stages
+ *   out         - receives the layout, owned by the layout cache
+ * 
+ * Returns:
+ *   false if the stages don't fit together or with the table
+ */
+bool get_reflected_layout_(vk_app* app, const shader_reflection* stages,
+        uint32_t stage_count, VkPipelineLayout* out) {
+    pipeline_layout_desc layout_desc;
 
-    if(vert_code == NULL) {
-        fprintf(stderr, "Failed to read shader code from \"vert.spv\"\n");
-        return false;
+    return merge_shader_reflections(stages, stage_count, &layout_desc) &&
+        patch_pipeline_layout_(app, &layout_desc) &&
+        get_pipeline_layout(&app->layouts, &layout_desc, NULL, out);
+}
+
+/**
+ * Warns about vertex shader inputs the scene's vertex layout doesn't
+ * feed, or feeds with a different format. Drawing would still work
+ * on most drivers but read garbage.
+ * 
+ * Params:
+ *   reflection - reflected vertex shader
+ *   desc       - pipeline description with its vertex attributes
+ */
+void check_vertex_inputs_(const shader_reflection* reflection,
+        const graphics_pipeline_desc* desc) {
+    for(uint32_t i = 0; i < reflection->vertex_input_count; i++) {
+        const reflected_vertex_input* input = &reflection->vertex_inputs[i];
+
+        uint32_t a = 0;
+        while(a < desc->attribute_count &&
+                desc->attributes[a].location != input->location) {
+            a++;
+        }
+
+        if(a == desc->attribute_count) {
+            fprintf(stderr, "Vertex input %i has no vertex attribute\n",
+                input->location);
+        }
+        else if(desc->attributes[a].format != input->format) {
+            fprintf(stderr, "Vertex input %i expects format %i, attribute has %i\n",
+                input->location, input->format, desc->attributes[a].format);
+        }
     }
+}
 
-    size_t frag_size;
-    uint32_t* frag_code = read_file("frag.spv", &frag_size);
-    if(frag_code == NULL) {
-        fprintf(stderr, "Failed to read shader code from \"frag.spv\"\n");
+/**
+ * Describes the scene pipeline for the current shaders and render
+ * target format. The pipeline layout is reflected from the shaders.
+ * 
+ * Params:
+ *   app  - vulkan app
+ *   desc - receives the description, its shader modules are owned
+ *          by the caller
+ * 
+ * Returns:
+ *   false if a shader couldn't be loaded or reflected
+ */
+bool fill_scene_pipeline_desc_(vk_app* app, graphics_pipeline_desc* desc) {
+    shader_reflection stages[SCENE_SHADER_COUNT];
+
+    memset(desc, 0, sizeof(graphics_pipeline_desc));
+    desc->vert_module = load_shader_module_(app, SCENE_SHADERS[0], &stages[0]);
+    desc->frag_module = load_shader_module_(app, SCENE_SHADERS[1], &stages[1]);
+
+    // Vertices are pulled from the bindless table, the only vertex
+    // binding is the per-instance data
+    desc->binding_count = 1;
+    desc->bindings[0].binding = INSTANCE_BINDING;
+    desc->bindings[0].stride = sizeof(instance_data);
+    desc->bindings[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    desc->attribute_count = 2;
+    desc->attributes[0].location = 0;
+    desc->attributes[0].binding = INSTANCE_BINDING;
+    desc->attributes[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    desc->attributes[0].offset = offsetof(instance_data, transform);
+    desc->attributes[1].location = 1;
+    desc->attributes[1].binding = INSTANCE_BINDING;
+    desc->attributes[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    desc->attributes[1].offset = offsetof(instance_data, color);
+
+    desc->state = app->scene_draw_state;
+    desc->dynamic_state = app->dynamic_state;
+
+    desc->render_pass = app->render_pass;
+    desc->color_format = app->swapchain_format.format;
+
+    bool success = desc->vert_module != VK_NULL_HANDLE &&
+        desc->frag_module != VK_NULL_HANDLE &&
+        get_reflected_layout_(app, stages, SCENE_SHADER_COUNT, &desc->layout);
+
+    if(!success) {
+        vkDestroyShaderModule(app->device, desc->frag_module, NULL);
+        vkDestroyShaderModule(app->device, desc->vert_module, NULL);
         return false;
     }
 
-    // Shaders
-    VkShaderModule vert_module = create_shader_module(app, vert_code, vert_size);
-    VkShaderModule frag_module = create_shader_module(app, frag_code, frag_size);
-
-    VkPipelineShaderStageCreateInfo vert_stage_info = {};
-    vert_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vert_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vert_stage_info.module = vert_module;
-    vert_stage_info.pName = "main";
-
-    VkPipelineShaderStageCreateInfo frag_stage_info = {};
-    frag_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    frag_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    frag_stage_info.module = frag_module;
-    frag_stage_info.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shader_stages[] = {
-        vert_stage_info,
-        frag_stage_info
-    };
+    check_vertex_inputs_(&stages[0], desc);
 
-    // Vertex Info
-    VkPipelineVertexInputStateCreateInfo vert_input_info = {};
-    vert_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vert_input_info.vertexBindingDescriptionCount = 0;
-    vert_input_info.pVertexBindingDescriptions = NULL;
-    vert_input_info.vertexAttributeDescriptionCount = 0;
-    vert_input_info.pVertexAttributeDescriptions = NULL;
-
-    // Topology info
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_info = {};
-    input_assembly_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    input_assembly_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    input_assembly_info.primitiveRestartEnable = VK_FALSE;
-
-    // Viewport & scissor
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)app->swapchain_extent.width;
-    viewport.height = (float)app->swapchain_extent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor = {};
-    scissor.offset.x = 0;
-    scissor.offset.y = 0;
-    scissor.extent = app->swapchain_extent;
-
-    VkPipelineViewportStateCreateInfo vp_info = {};
-    vp_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    vp_info.viewportCount = 1;
-    vp_info.pViewports = &viewport;
-    vp_info.scissorCount = 1;
-    vp_info.pScissors = &scissor;
-
-    // Rasterizer
-    VkPipelineRasterizationStateCreateInfo rast_info = {};
-    rast_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rast_info.depthClampEnable = VK_FALSE;
-    rast_info.rasterizerDiscardEnable = VK_FALSE;
-    rast_info.polygonMode = VK_POLYGON_MODE_FILL;
-    rast_info.lineWidth = 1.0f;
-    rast_info.cullMode = VK_CULL_MODE_BACK_BIT;
-    rast_info.frontFace = VK_FRONT_FACE_CLOCKWISE;    
-    rast_info.depthBiasEnable = VK_FALSE;
-    rast_info.depthBiasConstantFactor = 0.0f;
-    rast_info.depthBiasClamp = 0.0f;
-    rast_info.depthBiasSlopeFactor = 0.0f;    
-
-    // Multisampling
-    VkPipelineMultisampleStateCreateInfo multi_info = {};
-    multi_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multi_info.sampleShadingEnable = VK_FALSE;
-    multi_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multi_info.minSampleShading = 1.0f;
-    multi_info.pSampleMask = NULL;
-    multi_info.alphaToCoverageEnable = VK_FALSE;
-    multi_info.alphaToOneEnable = VK_FALSE;
-
-    // Color blending
-    VkPipelineColorBlendAttachmentState blend_attachment = {};
-    blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | 
-        VK_COLOR_COMPONENT_G_BIT | 
-        VK_COLOR_COMPONENT_B_BIT |
-        VK_COLOR_COMPONENT_A_BIT;
-    blend_attachment.blendEnable = VK_FALSE;
-    blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-    blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-    blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
-    blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-    VkPipelineColorBlendStateCreateInfo blend_info = {};
-    blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    blend_info.logicOpEnable = VK_FALSE;
-    blend_info.logicOp = VK_LOGIC_OP_COPY;
-    blend_info.attachmentCount = 1;
-    blend_info.pAttachments = &blend_attachment;
-    blend_info.blendConstants[0] = 0.0f;
-    blend_info.blendConstants[1] = 0.0f;
-    blend_info.blendConstants[2] = 0.0f;
-    blend_info.blendConstants[3] = 0.0f;
-
-    // Pipeline Layout
-    VkPipelineLayoutCreateInfo pipeline_layout = {};
-    pipeline_layout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout.setLayoutCount = 0;
-    pipeline_layout.pSetLayouts = NULL;
-    pipeline_layout.pushConstantRangeCount = 0;
-    pipeline_layout.pPushConstantRanges = NULL;
-
-    VkResult result = vkCreatePipelineLayout(app->device,
-            &pipeline_layout,
-            NULL,
-            &app->pipeline_layout);
+    return true;
+}
 
-    if(result == VK_SUCCESS) {
-        printf("Successfully created pipeline layout\n");
+bool create_graphics_pipeline_(vk_app* app) {
+    graphics_pipeline_desc desc;
+    if(!fill_scene_pipeline_desc_(app, &desc)) {
+        return false;
     }
-    else {
-        fprintf(stderr, "Failed to create pipeline layout\n");
-    }
-
-    VkGraphicsPipelineCreateInfo pipeline_info = {};
-    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipeline_info.stageCount = 2;
-    pipeline_info.pStages = shader_stages;
-    pipeline_info.pVertexInputState = &vert_input_info;
-    pipeline_info.pInputAssemblyState = &input_assembly_info;
-    pipeline_info.pViewportState = &vp_info;
-    pipeline_info.pRasterizationState = &rast_info;
-    pipeline_info.pMultisampleState = &multi_info;
-    pipeline_info.pDepthStencilState = NULL;
-    pipeline_info.pColorBlendState = &blend_info;
-    pipeline_info.pDynamicState = NULL;
-
-    pipeline_info.layout = app->pipeline_layout;
-    pipeline_info.renderPass = app->render_pass;
-    pipeline_info.subpass = 0;
-    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
-    pipeline_info.basePipelineIndex = -1;
-
-    result = vkCreateGraphicsPipelines(app->device, VK_NULL_HANDLE,
-        1, &pipeline_info, NULL, &app->graphics_pipeline);
+    app->pipeline_layout = desc.layout;
 
-    if(result == VK_SUCCESS) {
-        printf("Successfully created graphics pipeline\n");
+    // Draws are skipped until the compile finishes
+    app->graphics_pipeline = pipeline_compiler_submit(&app->pipelines, &desc);
+
+    if(app->graphics_pipeline != PIPELINE_HANDLE_NONE) {
+        printf("Queued graphics pipeline\n");
     }
     else {
         fprintf(stderr, "Failed to create graphics pipeline\n");
     }
 
-    vkDestroyShaderModule(app->device, frag_module, NULL);
-    free(frag_code);
-    frag_code = NULL;
-
-    vkDestroyShaderModule(app->device, vert_module, NULL);
-    free(vert_code);
-    vert_code = NULL;
-
-    return result == VK_SUCCESS;
+    return app->graphics_pipeline != PIPELINE_HANDLE_NONE;
 }
 
 bool create_framebuffers_(vk_app* app) {
 
     // will have as many framebuffers as we do swapchain images
-    app->framebuffer_count = app->swapchain_image_count;
-
-    app->framebuffers = (VkFramebuffer*)malloc(sizeof(VkFramebuffer) * app->framebuffer_count);
-    
     VkResult result = VK_SUCCESS;
     for(uint32_t i = 0; i < app->swapchain_image_count && result == VK_SUCCESS; i++) {
         VkImageView attachments[] = {
-            app->swapchain_image_views[i]
+            app->swapchain_images[i].view
         };
 
         VkFramebufferCreateInfo buf_info = {};
@@ -1206,7 +2301,7 @@ bool create_framebuffers_(vk_app* app) {
             app->device,
             &buf_info,
             NULL,
-            &app->framebuffers[i]
+            &app->swapchain_images[i].framebuffer
         );
 
         if(result != VK_SUCCESS) {
@@ -1226,183 +2321,1342 @@ bool create_framebuffers_(vk_app* app) {
     return success;
 }
 
-bool create_cmd_pool_(vk_app* app) {
-    queue_families fams = find_queue_families_(app->physical_device,
-        app->surface);
+/**
+ * Allocates the ring of frame contexts. It is one contiguous block,
+ * and each context starts on its own cache line, so a frame only
+ * touches its own lines. The contexts are filled in by the create
+ * functions of the objects they own.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool create_frame_contexts_(vk_app* app) {
+    app->frames = (frame_context*)calloc_aligned(FRAME_CONTEXT_ALIGNMENT,
+        app->config.frames_in_flight, sizeof(frame_context));
+
+    if(app->frames == NULL) {
+        fprintf(stderr, "Unable to allocate frame contexts\n");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Destroys everything owned by the frame contexts and frees the
+ * ring. The device must be idle.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void cleanup_frame_contexts_(vk_app* app) {
+    if(app->frames == NULL) {
+        return;
+    }
+
+    for(uint32_t i = 0; i < app->config.frames_in_flight; i++) {
+        frame_context* frame = &app->frames[i];
+
+        vkDestroySemaphore(app->device, frame->render_finished, NULL);
+        vkDestroySemaphore(app->device, frame->image_available, NULL);
+        vkDestroyQueryPool(app->device, frame->timestamp_pool, NULL);
+
+        // Destroying the pools frees the command buffers
+        vkDestroyCommandPool(app->device, frame->cmd_pool, NULL);
+        vkDestroyCommandPool(app->device, frame->compute_cmd_pool, NULL);
+
+        destroy_gpu_buffer(&app->allocator, &frame->animated_vertices);
+    }
+
+    free_aligned(app->frames);
+    app->frames = NULL;
+}
 
+/**
+ * Creates one transient command pool per frame in flight. Each pool
+ * is reset as a whole once its frame has retired, which is much
+ * cheaper than freeing or resetting individual command buffers.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool create_cmd_pools_(vk_app* app) {
     VkCommandPoolCreateInfo pool_info = {};
     pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    pool_info.queueFamilyIndex = fams.graphics_family_index;
-    pool_info.flags = 0;
+    pool_info.queueFamilyIndex = app->queue_topology.graphics_family_index;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-    VkResult result = vkCreateCommandPool(
-        app->device,
-        &pool_info,
-        NULL,
-        &app->cmd_pool
-    );
+    VkResult result = VK_SUCCESS;
+    for(uint32_t i = 0; i < app->config.frames_in_flight && result == VK_SUCCESS; i++) {
+        result = vkCreateCommandPool(
+            app->device,
+            &pool_info,
+            NULL,
+            &app->frames[i].cmd_pool
+        );
+    }
 
     bool success = result == VK_SUCCESS;
 
     if(success) {
-        printf("Successfully created command pool\n");
+        printf("Successfully created %i command pools\n", app->config.frames_in_flight);
     }
     else {
-        fprintf(stderr, "Failed to create command pool\n");
+        fprintf(stderr, "Failed to create command pools\n");
     }
 
     return success;
 }
 
+/**
+ * Allocates the primary command buffer for each frame in flight.
+ * Buffers are left empty here and recorded every frame in
+ * draw_frame_.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
 bool create_cmd_buffers_(vk_app* app) {
 
-    // Cmd buffer per framebuffer
-    app->cmd_buffer_count = app->framebuffer_count;
-    app->cmd_buffers = (VkCommandBuffer*)malloc(
-        sizeof(VkCommandBuffer) * app->cmd_buffer_count);
-
-    VkCommandBufferAllocateInfo buf_info = {};
-    buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    buf_info.commandPool = app->cmd_pool;
-    buf_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    buf_info.commandBufferCount = app->cmd_buffer_count;
+    // Cmd buffer per frame in flight, each from its frame's pool
+    bool success = true;
+    for(uint32_t i = 0; i < app->config.frames_in_flight && success; i++) {
+        VkCommandBufferAllocateInfo buf_info = {};
+        buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        buf_info.commandPool = app->frames[i].cmd_pool;
+        buf_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        buf_info.commandBufferCount = 1;
 
-    bool success = vkAllocateCommandBuffers(app->device, &buf_info, app->cmd_buffers) == VK_SUCCESS;
+        success = vkAllocateCommandBuffers(app->device, &buf_info,
+            &app->frames[i].cmd) == VK_SUCCESS;
+    }
 
     if(success) {
-        printf("Successfully created %i command buffers\n", app->cmd_buffer_count);
+        printf("Successfully created %i command buffers\n", app->config.frames_in_flight);
     }
     else {
         fprintf(stderr, "Unable to create command buffers\n");
-        return success;
     }
 
-    VkResult result = VK_SUCCESS;
-    for(uint32_t i = 0; i < app->cmd_buffer_count && result == VK_SUCCESS; i++) {
-        VkCommandBufferBeginInfo beg_info = {};
-        beg_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beg_info.flags = 0;
-        beg_info.pInheritanceInfo = NULL;
-
-        result = vkBeginCommandBuffer(app->cmd_buffers[i], &beg_info);
-
-        if(result != VK_SUCCESS) {
-            fprintf(stderr, "Unable to begin cmd buffer %i\n", i);
-            break;
-        }
-
-        VkRenderPassBeginInfo pass_info = {};
-        pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        pass_info.renderPass = app->render_pass;
-        pass_info.framebuffer = app->framebuffers[i];
-
-        VkOffset2D offset = {0, 0};
-        pass_info.renderArea.offset = offset;
-        pass_info.renderArea.extent = app->swapchain_extent;
-
-        VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-        pass_info.clearValueCount = 1;
-        pass_info.pClearValues = &clearColor;
-
-        vkCmdBeginRenderPass(app->cmd_buffers[i], &pass_info, VK_SUBPASS_CONTENTS_INLINE);
-
-        vkCmdBindPipeline(app->cmd_buffers[i],
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            app->graphics_pipeline);
-
-        vkCmdDraw(app->cmd_buffers[i], 3, 1, 0, 0);
-
-        vkCmdEndRenderPass(app->cmd_buffers[i]);
+    return success;
+}
 
-        result = vkEndCommandBuffer(app->cmd_buffers[i]);
+/**
+ * Uploads the scene's vertex and index data into device-local
+ * buffers. Both uploads share one staging submission on the
+ * transfer queue.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool create_scene_buffers_(vk_app* app) {
+    bool success = init_buffer_uploader(&app->uploader, &app->allocator,
+        app->transfer_queue, app->queue_topology.transfer_family_index);
 
-        if(result != VK_SUCCESS) {
-            fprintf(stderr, "Unable to fill cmd buffer %i\n", i);
-            break;
-        }
+    // The rest pose is read by the compute pass, indices by graphics
+    if(success) success &= begin_buffer_uploads(&app->uploader);
+    if(success) {
+        success &= upload_device_local_buffer(&app->uploader, SCENE_VERTICES,
+            sizeof(vertex) * SCENE_VERTEX_COUNT,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            app->queue_topology.compute_family_index, &app->vertex_buffer);
+    }
+    if(success) {
+        success &= upload_device_local_buffer(&app->uploader, SCENE_INDICES,
+            sizeof(uint32_t) * SCENE_INDEX_COUNT,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            app->queue_topology.graphics_family_index, &app->index_buffer);
     }
 
-    success = result == VK_SUCCESS;
+    // Flush even on failure so no staging buffer is left behind
+    success &= flush_buffer_uploads(&app->uploader);
+
+    app->vertex_count = SCENE_VERTEX_COUNT;
+    app->index_count = SCENE_INDEX_COUNT;
 
     if(success) {
-        printf("Successfully initialized command buffers\n");
+        printf("Uploaded %i vertices and %i indices\n",
+            SCENE_VERTEX_COUNT, SCENE_INDEX_COUNT);
     }
     else {
-        fprintf(stderr, "Unable to initialize command buffers\n");
+        fprintf(stderr, "Unable to upload scene buffers\n");
     }
 
-    return success;
+    return success && upload_instances_(app, app->config.instance_count);
 }
 
-bool create_sync_objects_(vk_app* app) {
-    app->image_available = (VkSemaphore*)malloc(sizeof(VkSemaphore) * MAX_FRAMES_IN_FLIGHT);
-    app->render_finished = (VkSemaphore*)malloc(sizeof(VkSemaphore) * MAX_FRAMES_IN_FLIGHT);
-    app->in_flight = (VkFence*)malloc(sizeof(VkFence) * MAX_FRAMES_IN_FLIGHT);
-
-    app->imgs_in_flight = (VkFence*)malloc(sizeof(VkFence) * MAX_FRAMES_IN_FLIGHT);
-    for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        app->imgs_in_flight[i] = VK_NULL_HANDLE;
+/**
+ * Returns the column count of the smallest square grid with a cell
+ * for each of count items.
+ */
+uint32_t grid_columns_(uint32_t count) {
+    uint32_t columns = 1;
+    while(columns * columns < count) {
+        columns++;
     }
 
-    VkSemaphoreCreateInfo sem_info = {};
-    sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    return columns;
+}
 
-    VkFenceCreateInfo fence_info = {};
-    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    
-    for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkCreateSemaphore(app->device, &sem_info, NULL, &app->image_available[i]);
-        vkCreateSemaphore(app->device, &sem_info, NULL, &app->render_finished[i]);
-        vkCreateFence(app->device, &fence_info, NULL, &app->in_flight[i]);
+/**
+ * Lays count instances out on a grid spanning the scene, with
+ * rotations and tints varying between neighbours, and uploads them
+ * as the instance buffer. A single instance is the untransformed
+ * scene. The previous instance buffer is destroyed, so the GPU must
+ * be done with it.
+ * 
+ * Params:
+ *   app   - vulkan app
+ *   count - number of instances
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool upload_instances_(vk_app* app, uint32_t count) {
+    instance_data* instances = (instance_data*)malloc(sizeof(instance_data) * count);
+    if(instances == NULL) {
+        fprintf(stderr, "Unable to allocate %i instances\n", count);
+        return false;
     }
 
-    return true;
-}
+    // Same layout as write_draw_uniforms_, one level down
+    uint32_t columns = grid_columns_(count);
+    float cell = 2.0f / (float)columns;
 
-void draw_frame_(vk_app* app) {
-    vkWaitForFences(app->device, 1, &app->in_flight[app->current_frame],
-        VK_TRUE, UINT64_MAX);
+    for(uint32_t i = 0; i < count; i++) {
+        instance_data* instance = &instances[i];
+        const float* tint = INSTANCE_TINTS[i % INSTANCE_TINT_COUNT];
 
-    uint32_t image_index;
-    vkAcquireNextImageKHR(app->device, app->swapchain, UINT64_MAX,
-        app->image_available[app->current_frame], VK_NULL_HANDLE,
-        &image_index);
+        instance->transform[0] = -1.0f + cell * ((float)(i % columns) + 0.5f);
+        instance->transform[1] = -1.0f + cell * ((float)(i / columns) + 0.5f);
+        instance->transform[2] = 1.0f / (float)columns;
+        instance->transform[3] = (float)(i % 8) * 0.25f * 3.14159265f;
 
-    if(app->imgs_in_flight[image_index] != VK_NULL_HANDLE) {
-        vkWaitForFences(app->device, 1, &app->imgs_in_flight[image_index], VK_TRUE, UINT64_MAX);
+        instance->color[0] = tint[0];
+        instance->color[1] = tint[1];
+        instance->color[2] = tint[2];
+        instance->color[3] = 1.0f;
     }
-    app->imgs_in_flight[image_index] = app->in_flight[app->current_frame];
-    
-    VkSemaphore wait_sems[] = {app->image_available[app->current_frame]};
-    VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 
-    VkSubmitInfo submit_info = {};
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    if(app->instance_buffer.buffer != VK_NULL_HANDLE) {
+        destroy_gpu_buffer(&app->allocator, &app->instance_buffer);
+    }
+    app->instance_count = 0;
+
+    bool success = begin_buffer_uploads(&app->uploader) &&
+        upload_device_local_buffer(&app->uploader, instances,
+            sizeof(instance_data) * count, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            app->queue_topology.graphics_family_index, &app->instance_buffer);
+
+    // Flush even on failure so no staging buffer is left behind
+    success &= flush_buffer_uploads(&app->uploader);
+    free(instances);
+
+    if(success) {
+        app->instance_count = count;
+    }
+    else {
+        fprintf(stderr, "Unable to upload %i instances\n", count);
+    }
+
+    return success;
+}
+
+/**
+ * Sets up the async compute pass that animates the scene: the
+ * pipeline, and in every frame context a vertex buffer registered
+ * with the bindless table and a command pool.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool create_compute_pass_(vk_app* app) {
+    app->start_time = get_time_seconds();
+
+    shader_reflection reflection;
+    VkShaderModule module = load_shader_module_(app, ANIMATE_SHADER, &reflection);
+    if(module == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    // record_compute_cmd_ pushes an animate_params
+    if(reflection.push_constants.size != sizeof(animate_params)) {
+        fprintf(stderr, "%s push constants are %i bytes, expected %zu\n",
+            ANIMATE_SHADER, reflection.push_constants.size, sizeof(animate_params));
+    }
+
+    pipeline_layout_desc layout_desc;
+    bool success = merge_shader_reflections(&reflection, 1, &layout_desc) &&
+        patch_pipeline_layout_(app, &layout_desc) &&
+        create_compute_pipeline(app->device, app->pipeline_cache,
+            &app->layouts, module, &layout_desc, &app->animate_pipeline);
+
+    vkDestroyShaderModule(app->device, module, NULL);
+
+    if(!success) {
+        return false;
+    }
+
+    app->vertex_buffer_index = bindless_register_buffer(&app->bindless,
+        app->vertex_buffer.buffer, 0, VK_WHOLE_SIZE);
+    if(app->vertex_buffer_index == BINDLESS_INDEX_NONE) {
+        return false;
+    }
+
+    VkCommandPoolCreateInfo cmd_pool_info = {};
+    cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmd_pool_info.queueFamilyIndex = app->queue_topology.compute_family_index;
+    cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    VkDeviceSize vertex_bytes = sizeof(vertex) * app->vertex_count;
+
+    VkResult result = VK_SUCCESS;
+    for(uint32_t i = 0; i < app->config.frames_in_flight && result == VK_SUCCESS; i++) {
+        frame_context* frame = &app->frames[i];
+
+        // Written by compute, read by the vertex shader. Kept
+        // exclusive and handed over with ownership transfers.
+        if(!create_gpu_buffer(&app->allocator, vertex_bytes,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, NULL, 0,
+                &frame->animated_vertices)) {
+            fprintf(stderr, "Unable to create animated vertex buffer %i\n", i);
+            return false;
+        }
+
+        frame->animated_vertices_index = bindless_register_buffer(&app->bindless,
+            frame->animated_vertices.buffer, 0, VK_WHOLE_SIZE);
+        if(frame->animated_vertices_index == BINDLESS_INDEX_NONE) {
+            return false;
+        }
+
+        result = vkCreateCommandPool(app->device, &cmd_pool_info, NULL,
+            &frame->compute_cmd_pool);
+
+        if(result == VK_SUCCESS) {
+            VkCommandBufferAllocateInfo buf_info = {};
+            buf_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            buf_info.commandPool = frame->compute_cmd_pool;
+            buf_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            buf_info.commandBufferCount = 1;
+
+            result = vkAllocateCommandBuffers(app->device, &buf_info,
+                &frame->compute_cmd);
+        }
+    }
+
+    if(result == VK_SUCCESS) {
+        printf("Created async compute pass\n");
+    }
+    else {
+        fprintf(stderr, "Unable to create compute command buffers\n");
+    }
+
+    return result == VK_SUCCESS;
+}
+
+/**
+ * Records the frame's vertex animation. When compute and graphics
+ * are different families the written buffer is released to the
+ * graphics family at the end.
+ * 
+ * Params:
+ *   app   - vulkan app
+ *   frame - index of the frame in flight
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool record_compute_cmd_(vk_app* app, uint32_t frame) {
+    frame_context* ctx = &app->frames[frame];
+
+    // The frame has retired on graphics, which waited on this frame's
+    // compute work, so nothing from the pool is pending
+    vkResetCommandPool(app->device, ctx->compute_cmd_pool, 0);
+
+    VkCommandBuffer cmd = ctx->compute_cmd;
+
+    VkCommandBufferBeginInfo beg_info = {};
+    beg_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beg_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if(vkBeginCommandBuffer(cmd, &beg_info) != VK_SUCCESS) {
+        fprintf(stderr, "Unable to begin compute cmd buffer\n");
+        return false;
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+        app->animate_pipeline.pipeline);
+    cmd_bind_bindless_table(cmd, &app->bindless, VK_PIPELINE_BIND_POINT_COMPUTE,
+        app->animate_pipeline.layout);
+
+    animate_params params;
+    params.time = (float)(get_time_seconds() - app->start_time);
+    params.vertex_count = app->vertex_count;
+    params.base_buffer = app->vertex_buffer_index;
+    params.animated_buffer = ctx->animated_vertices_index;
+
+    vkCmdPushConstants(cmd, app->animate_pipeline.layout,
+        VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(animate_params), &params);
+
+    vkCmdDispatch(cmd,
+        (app->vertex_count + ANIMATE_GROUP_SIZE - 1) / ANIMATE_GROUP_SIZE, 1, 1);
+
+    // The whole buffer is rewritten every frame, so there is nothing
+    // to acquire back from graphics before the dispatch
+    uint32_t compute_family = app->queue_topology.compute_family_index;
+    uint32_t graphics_family = app->queue_topology.graphics_family_index;
+    if(compute_family != graphics_family) {
+        cmd_release_buffer_ownership(cmd, ctx->animated_vertices.buffer,
+            compute_family, graphics_family,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    }
+
+    if(vkEndCommandBuffer(cmd) != VK_SUCCESS) {
+        fprintf(stderr, "Unable to record compute cmd buffer\n");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Starts the worker threads that record secondary command buffers,
+ * if the app was configured with any. With zero threads all
+ * recording stays on the main thread.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool create_record_workers_(vk_app* app) {
+    if(app->config.record_thread_count == 0) {
+        return true;
+    }
+
+    app->secondary_cmds = (VkCommandBuffer*)malloc(
+        sizeof(VkCommandBuffer) * app->config.record_thread_count);
+
+    return init_record_workers(&app->workers, app->device,
+        app->queue_topology.graphics_family_index, app->config.record_thread_count,
+        app->config.frames_in_flight);
+}
+
+/**
+ * Picks the frame's draw count and writes their uniforms. When
+ * recording workers are running the draws are recorded into
+ * secondary command buffers right away. None of it depends on the
+ * swapchain image, so it runs before the image is acquired.
+ * 
+ * Params:
+ *   app   - vulkan app
+ *   frame - index of the frame in flight, it must have retired
+ * 
+ * Returns:
+ *   false if a worker failed, the frame must be skipped
+ */
+bool record_secondary_draws_(vk_app* app, uint32_t frame) {
+    // The pass still clears while the scene pipeline compiles
+    uint32_t draw_count = app->frame_pipeline != VK_NULL_HANDLE ?
+        app->config.scene_draw_count : 0;
+
+    // Workers only read the uniforms, so they are written up front
+    if(draw_count > 0 && !write_draw_uniforms_(app, draw_count)) {
+        draw_count = 0;
+    }
+
+    app->frame_draw_count = draw_count;
+    app->frame_secondary_count = 0;
+
+    if(app->config.record_thread_count == 0 || draw_count == 0) {
+        return true;
+    }
+
+    // Under dynamic rendering the secondaries inherit the attachment
+    // formats instead of the render pass. The framebuffer is only a
+    // hint and isn't known before the acquire.
+    VkCommandBufferInheritanceRenderingInfoKHR rendering_inheritance = {};
+    rendering_inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+    rendering_inheritance.colorAttachmentCount = 1;
+    rendering_inheritance.pColorAttachmentFormats = &app->swapchain_format.format;
+    rendering_inheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance = {};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    if(app->dynamic_rendering_enabled) {
+        inheritance.pNext = &rendering_inheritance;
+    }
+    inheritance.renderPass = app->render_pass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = VK_NULL_HANDLE;
+
+    app->frame_secondary_count = record_workers_dispatch(&app->workers,
+        frame, &inheritance, draw_count, record_draws_, app,
+        app->secondary_cmds);
+
+    // Only a failed worker leaves draws unrecorded. Skip the frame
+    // rather than submit part of the scene, the pools are reset
+    // before the next attempt.
+    if(app->frame_secondary_count == 0) {
+        fprintf(stderr, "Unable to record draws, skipping frame\n");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Records the primary command buffer of a single frame. Draws are
+ * either recorded inline or executed from the secondaries
+ * record_secondary_draws_ recorded.
+ * 
+ * Params:
+ *   app         - vulkan app
+ *   cmd         - command buffer to record into, must be reset
+ *   frame       - index of the frame in flight
+ *   image_index - index of the swapchain image being rendered to
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool record_cmd_buffer_(vk_app* app, VkCommandBuffer cmd, uint32_t frame,
+        uint32_t image_index) {
+    frame_context* ctx = &app->frames[frame];
+    VkFramebuffer framebuffer = app->swapchain_images[image_index].framebuffer;
+
+    VkCommandBufferBeginInfo beg_info = {};
+    beg_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beg_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beg_info.pInheritanceInfo = NULL;
+
+    VkResult result = vkBeginCommandBuffer(cmd, &beg_info);
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to begin cmd buffer\n");
+        return false;
+    }
+
+    // Take the animated vertices over from the compute family
+    uint32_t compute_family = app->queue_topology.compute_family_index;
+    uint32_t graphics_family = app->queue_topology.graphics_family_index;
+    if(compute_family != graphics_family) {
+        cmd_acquire_buffer_ownership(cmd, ctx->animated_vertices.buffer,
+            compute_family, graphics_family,
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    // Bracket the whole render pass with timestamps
+    if(app->timestamps_supported) {
+        vkCmdResetQueryPool(cmd, ctx->timestamp_pool, 0, 2);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            ctx->timestamp_pool, 0);
+    }
+
+    VkOffset2D offset = {0, 0};
+    VkRect2D render_area = {};
+    render_area.offset = offset;
+    render_area.extent = app->swapchain_extent;
+
+    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+
+    uint32_t draw_count = app->frame_draw_count;
+    uint32_t secondary_count = app->frame_secondary_count;
+    bool secondary = secondary_count > 0;
+
+    if(app->dynamic_rendering_enabled) {
+        VkImage image = app->swapchain_images[image_index].image;
+
+        // The previous contents are cleared, so the old layout doesn't
+        // matter. The acquire semaphore is waited on at this stage.
+        cmd_transition_image_(cmd, image,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+
+        VkRenderingAttachmentInfoKHR color_attachment = {};
+        color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        color_attachment.imageView = app->swapchain_images[image_index].view;
+        color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        color_attachment.resolveMode = VK_RESOLVE_MODE_NONE;
+        color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        color_attachment.clearValue = clearColor;
+
+        VkRenderingInfoKHR rendering_info = {};
+        rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        rendering_info.flags = secondary ?
+            VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+        rendering_info.renderArea = render_area;
+        rendering_info.layerCount = 1;
+        rendering_info.colorAttachmentCount = 1;
+        rendering_info.pColorAttachments = &color_attachment;
+
+        app->cmd_begin_rendering(cmd, &rendering_info);
+    }
+    else {
+        VkRenderPassBeginInfo pass_info = {};
+        pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        pass_info.renderPass = app->render_pass;
+        pass_info.framebuffer = framebuffer;
+        pass_info.renderArea = render_area;
+        pass_info.clearValueCount = 1;
+        pass_info.pClearValues = &clearColor;
+
+        vkCmdBeginRenderPass(cmd, &pass_info, secondary ?
+            VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS :
+            VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    if(secondary) {
+        vkCmdExecuteCommands(cmd, secondary_count, app->secondary_cmds);
+    }
+    else if(draw_count > 0) {
+        record_draws_(app, cmd, 0, draw_count);
+    }
+
+    if(app->dynamic_rendering_enabled) {
+        app->cmd_end_rendering(cmd);
+
+        // Same final layout the render pass would have transitioned to
+        VkImageLayout final_layout = app->config.headless ?
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        cmd_transition_image_(cmd, app->swapchain_images[image_index].image,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, final_layout,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+    }
+    else {
+        vkCmdEndRenderPass(cmd);
+    }
+
+    if(app->timestamps_supported) {
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            ctx->timestamp_pool, 1);
+    }
+
+    result = vkEndCommandBuffer(cmd);
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to record cmd buffer for image %i\n", image_index);
+    }
+
+    return result == VK_SUCCESS;
+}
+
+/**
+ * Destroys the graphics pipeline. Its layout belongs to the layout
+ * cache. Waits for compiles in flight first, so the render pass they
+ * were described with can be destroyed afterwards.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void destroy_graphics_pipeline_(vk_app* app) {
+    pipeline_compiler_wait_idle(&app->pipelines);
+
+    pipeline_compiler_release(&app->pipelines, app->graphics_pipeline);
+    app->graphics_pipeline = PIPELINE_HANDLE_NONE;
+
+    // A reload in flight was built for the same layout and format
+    pipeline_compiler_release(&app->pipelines, app->pending_graphics_pipeline);
+    app->pending_graphics_pipeline = PIPELINE_HANDLE_NONE;
+
+    app->pipeline_layout = VK_NULL_HANDLE;
+    app->pending_pipeline_layout = VK_NULL_HANDLE;
+}
+
+/**
+ * Records a layout transition of a single mip, single layer color
+ * image.
+ * 
+ * Params:
+ *   cmd        - command buffer in the recording state
+ *   image      - image to transition
+ *   old_layout - current layout, or UNDEFINED to discard contents
+ *   new_layout - layout to transition to
+ *   src_stage  - stages that must finish before the transition
+ *   src_access - writes to make available
+ *   dst_stage  - stages that wait on the transition
+ *   dst_access - accesses the new contents are made visible to
+ */
+void cmd_transition_image_(VkCommandBuffer cmd, VkImage image,
+        VkImageLayout old_layout, VkImageLayout new_layout,
+        VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+        VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0,
+        0, NULL, 0, NULL, 1, &barrier);
+}
+
+/**
+ * Writes the uniform block of every draw of the frame into one run
+ * of the uniform ring.
+ * 
+ * Params:
+ *   app        - vulkan app
+ *   draw_count - number of draws
+ * 
+ * Returns:
+ *   false if the frame's uniform segment is full
+ */
+bool write_draw_uniforms_(vk_app* app, uint32_t draw_count) {
+    VkDeviceSize stride = uniform_ring_align(&app->uniforms, sizeof(draw_uniforms));
+
+    uint8_t* data = (uint8_t*)uniform_ring_alloc(&app->uniforms,
+        stride * draw_count, &app->draw_uniforms_offset);
+    if(data == NULL) {
+        fprintf(stderr, "Uniform ring is full, skipping %i draws\n", draw_count);
+        return false;
+    }
+    app->draw_uniforms_stride = (uint32_t)stride;
+
+    // Smallest square grid with a cell for every draw, the scene spans
+    // [-1, 1] so each cell is 2 / columns wide
+    uint32_t columns = grid_columns_(draw_count);
+    float cell = 2.0f / (float)columns;
+
+    for(uint32_t i = 0; i < draw_count; i++) {
+        draw_uniforms uniforms = {};
+        uniforms.offset[0] = -1.0f + cell * ((float)(i % columns) + 0.5f);
+        uniforms.offset[1] = -1.0f + cell * ((float)(i / columns) + 0.5f);
+        uniforms.scale = 1.0f / (float)columns;
+
+        memcpy(data + stride * i, &uniforms, sizeof(draw_uniforms));
+    }
+
+    return true;
+}
+
+/**
+ * Records a range of the scene's draws. Used both inline on the
+ * main thread and from recording workers, so it only reads app.
+ * Draws pull the vertices animated for the current frame from the
+ * bindless table and render every instance of the instance buffer.
+ * 
+ * Params:
+ *   user       - vulkan app
+ *   cmd        - command buffer in the recording state
+ *   first_draw - index of the first draw to record
+ *   draw_count - number of draws to record
+ */
+void record_draws_(void* user, VkCommandBuffer cmd, uint32_t first_draw,
+        uint32_t draw_count) {
+    const vk_app* app = (const vk_app*)user;
+
+    vkCmdBindPipeline(cmd,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        app->frame_pipeline);
+
+    cmd_set_draw_state(cmd, &app->dynamic_state, &app->scene_draw_state,
+        app->swapchain_extent);
+
+    // Bound once per command buffer, draws only differ in push
+    // constants
+    cmd_bind_bindless_table(cmd, &app->bindless, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        app->pipeline_layout);
+
+    draw_params params;
+    params.vertex_buffer = app->frames[app->current_frame].animated_vertices_index;
+    vkCmdPushConstants(cmd, app->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT,
+        0, sizeof(draw_params), &params);
+
+    vkCmdBindIndexBuffer(cmd, app->index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    VkDeviceSize instance_offset = 0;
+    vkCmdBindVertexBuffers(cmd, INSTANCE_BINDING, 1, &app->instance_buffer.buffer,
+        &instance_offset);
+
+    for(uint32_t i = first_draw; i < first_draw + draw_count; i++) {
+        cmd_bind_uniform_ring(cmd, &app->uniforms, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            app->pipeline_layout,
+            app->draw_uniforms_offset + app->draw_uniforms_stride * i);
+
+        vkCmdDrawIndexed(cmd, app->index_count, app->instance_count, 0, 0, 0);
+    }
+}
+
+/**
+ * Creates each frame's binary semaphores, used with the swapchain,
+ * and the graphics and compute timelines of the frame clock. Value 0
+ * means "never submitted", so everything starts out free.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool create_sync_objects_(vk_app* app) {
+    app->frame_clock = 0;
+
+    VkSemaphoreCreateInfo sem_info = {};
+    sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for(uint32_t i = 0; i < app->config.frames_in_flight; i++) {
+        vkCreateSemaphore(app->device, &sem_info, NULL, &app->frames[i].image_available);
+        vkCreateSemaphore(app->device, &sem_info, NULL, &app->frames[i].render_finished);
+    }
+
+    bool success = create_timeline_semaphore(app->device, 0, &app->graphics_timeline);
+    success &= create_timeline_semaphore(app->device, 0, &app->compute_timeline);
+
+    return success;
+}
+
+/**
+ * Creates a timestamp query pool per frame in flight, if the
+ * graphics queue supports timestamps. Lack of support isn't an
+ * error, GPU frame times are just not collected.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool create_timestamp_queries_(vk_app* app) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(app->physical_device, &props);
+
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(app->physical_device, &family_count, NULL);
+
+    VkQueueFamilyProperties* families = (VkQueueFamilyProperties*)malloc(
+            family_count * sizeof(VkQueueFamilyProperties));
+    vkGetPhysicalDeviceQueueFamilyProperties(app->physical_device, &family_count, families);
+
+    uint32_t valid_bits = families[app->queue_topology.graphics_family_index].timestampValidBits;
+    free(families);
+
+    app->timestamps_supported = valid_bits > 0 && props.limits.timestampPeriod > 0.0f;
+    if(!app->timestamps_supported) {
+        printf("Graphics queue doesn't support timestamps, GPU timing disabled\n");
+        return true;
+    }
+
+    app->timestamp_period = props.limits.timestampPeriod;
+    app->timestamp_mask = valid_bits >= 64 ? UINT64_MAX : ((1ULL << valid_bits) - 1);
+
+    VkQueryPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_info.queryCount = 2;
+
+    VkResult result = VK_SUCCESS;
+    for(uint32_t i = 0; i < app->config.frames_in_flight && result == VK_SUCCESS; i++) {
+        result = vkCreateQueryPool(app->device, &pool_info, NULL,
+            &app->frames[i].timestamp_pool);
+    }
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to create timestamp query pools\n");
+    }
+
+    return result == VK_SUCCESS;
+}
+
+/**
+ * Reads back the GPU time of the last submission of the given frame
+ * in flight and adds it to the GPU frame time history. Must only be
+ * called once that frame's timeline value was reached, so it never
+ * stalls.
+ * 
+ * Params:
+ *   app   - vulkan app
+ *   frame - index of the frame in flight
+ */
+void read_frame_timestamps_(vk_app* app, uint32_t frame) {
+    frame_context* ctx = &app->frames[frame];
+    if(!ctx->timestamps_pending) {
+        return;
+    }
+    ctx->timestamps_pending = false;
+
+    uint64_t stamps[2];
+    VkResult result = vkGetQueryPoolResults(app->device,
+        ctx->timestamp_pool, 0, 2, sizeof(stamps), stamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if(result == VK_SUCCESS) {
+        uint64_t ticks = (stamps[1] - stamps[0]) & app->timestamp_mask;
+        frame_time_history_add(&app->gpu_frame_times,
+            ticks * (double)app->timestamp_period / 1e6);
+    }
+}
+
+/**
+ * Starts watching the shader sources for changes.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   boolean indicating success
+ */
+bool init_hot_reload_(vk_app* app) {
+    bool success = init_shader_watcher(&app->watcher, LRN_VK_SHADER_SOURCE_DIR,
+        LRN_VK_HOT_SHADER_DIR, LRN_VK_SHADER_COMPILER,
+        LRN_VK_SHADER_COMPILER_IS_GLSLANG != 0);
+
+    if(!success) {
+        fprintf(stderr, "Shader hot reload disabled\n");
+    }
+
+    return success;
+}
+
+/**
+ * Recompiles shaders whose sources changed since the last frame and
+ * starts rebuilding the pipelines built from them. A shader that
+ * fails to compile leaves its pipelines untouched.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void poll_shader_changes_(vk_app* app) {
+    char changed[SHADER_WATCHER_MAX_SHADERS][SHADER_NAME_MAX];
+    uint32_t changed_count = poll_shader_watcher(&app->watcher, changed,
+        SHADER_WATCHER_MAX_SHADERS);
+
+    bool scene_changed = false;
+    bool animate_changed = false;
+
+    for(uint32_t i = 0; i < changed_count; i++) {
+        if(!compile_watched_shader(&app->watcher, changed[i])) {
+            continue;
+        }
+
+        for(uint32_t s = 0; s < SCENE_SHADER_COUNT; s++) {
+            scene_changed |= strcmp(changed[i], SCENE_SHADERS[s]) == 0;
+        }
+        animate_changed |= strcmp(changed[i], ANIMATE_SHADER) == 0;
+    }
+
+    if(scene_changed) {
+        reload_scene_pipeline_(app);
+    }
+    if(animate_changed) {
+        reload_animate_pipeline_(app);
+    }
+}
+
+/**
+ * Queues a rebuild of the scene pipeline. Frames keep drawing with
+ * the current one until update_pipeline_reloads_ swaps it out.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void reload_scene_pipeline_(vk_app* app) {
+    graphics_pipeline_desc desc;
+    if(!fill_scene_pipeline_desc_(app, &desc)) {
+        return;
+    }
+
+    // An older rebuild was never drawn with, drop it
+    pipeline_compiler_release(&app->pipelines, app->pending_graphics_pipeline);
+
+    app->pending_graphics_pipeline = pipeline_compiler_submit(&app->pipelines,
+        &desc);
+    app->pending_pipeline_layout = desc.layout;
+}
+
+/**
+ * Rebuilds the animation pipeline against its existing layout and
+ * swaps it in. The old pipeline is retired with the compute
+ * timeline. Edits that change the shader's interface are refused,
+ * record_compute_cmd_ only knows how to feed the current one.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void reload_animate_pipeline_(vk_app* app) {
+    shader_reflection reflection;
+    VkShaderModule module = load_shader_module_(app, ANIMATE_SHADER, &reflection);
+    if(module == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Layouts are deduplicated, so an unchanged interface yields the
+    // very same handle
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    if(!get_reflected_layout_(app, &reflection, 1, &layout) ||
+            layout != app->animate_pipeline.layout) {
+        fprintf(stderr, "%s changed its interface, restart to pick it up\n",
+            ANIMATE_SHADER);
+        vkDestroyShaderModule(app->device, module, NULL);
+        return;
+    }
+
+    // A single small pipeline, built on the spot
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    bool built = build_compute_pipeline(app->device, app->pipeline_cache,
+        module, app->animate_pipeline.layout, &pipeline);
+
+    vkDestroyShaderModule(app->device, module, NULL);
+
+    if(!built) {
+        fprintf(stderr, "Failed to rebuild %s pipeline\n", ANIMATE_SHADER);
+        return;
+    }
+
+    retire_pipeline_(app, PIPELINE_HANDLE_NONE, app->animate_pipeline.pipeline,
+        app->compute_timeline, app->frame_clock);
+    app->animate_pipeline.pipeline = pipeline;
+
+    printf("Reloaded %s pipeline\n", ANIMATE_SHADER);
+}
+
+/**
+ * Swaps in a rebuilt scene pipeline once it has compiled and
+ * destroys replaced pipelines whose frames have retired.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void update_pipeline_reloads_(vk_app* app) {
+    if(app->pending_graphics_pipeline != PIPELINE_HANDLE_NONE) {
+        pipeline_status status = pipeline_compiler_status(&app->pipelines,
+            app->pending_graphics_pipeline);
+
+        if(status == PIPELINE_READY) {
+            // Every frame submitted so far may still draw with it
+            retire_pipeline_(app, app->graphics_pipeline, VK_NULL_HANDLE,
+                app->graphics_timeline, app->frame_clock);
+
+            app->graphics_pipeline = app->pending_graphics_pipeline;
+            app->pending_graphics_pipeline = PIPELINE_HANDLE_NONE;
+
+            // The edit may have changed the shaders' interface
+            app->pipeline_layout = app->pending_pipeline_layout;
+
+            printf("Reloaded scene pipeline\n");
+        }
+        else if(status == PIPELINE_FAILED) {
+            pipeline_compiler_release(&app->pipelines,
+                app->pending_graphics_pipeline);
+            app->pending_graphics_pipeline = PIPELINE_HANDLE_NONE;
+
+            fprintf(stderr, "Keeping the previous scene pipeline\n");
+        }
+    }
+
+    release_retired_pipelines_(app, false);
+}
+
+/**
+ * Keeps a replaced pipeline alive until timeline reaches value. If
+ * too many are waiting, blocks until all of them can go.
+ * 
+ * Params:
+ *   app      - vulkan app
+ *   handle   - compiler handle of a graphics pipeline, or
+ *              PIPELINE_HANDLE_NONE
+ *   pipeline - pipeline owned by the app, or VK_NULL_HANDLE
+ *   timeline - timeline the pipeline's last use signals
+ *   value    - value signaled after its last use
+ */
+void retire_pipeline_(vk_app* app, pipeline_handle handle, VkPipeline pipeline,
+        VkSemaphore timeline, uint64_t value) {
+    if(app->retired_pipeline_count == MAX_RETIRED_PIPELINES) {
+        for(uint32_t i = 0; i < app->retired_pipeline_count; i++) {
+            wait_timeline(app->device, app->retired_pipelines[i].timeline,
+                app->retired_pipelines[i].value);
+        }
+        release_retired_pipelines_(app, true);
+    }
+
+    retired_pipeline* retired = &app->retired_pipelines[app->retired_pipeline_count++];
+    retired->handle = handle;
+    retired->pipeline = pipeline;
+    retired->timeline = timeline;
+    retired->value = value;
+}
+
+/**
+ * Destroys retired pipelines the GPU is done with.
+ * 
+ * Params:
+ *   app - vulkan app
+ *   all - release every retired pipeline without checking, the
+ *         caller has made sure none are in use
+ */
+void release_retired_pipelines_(vk_app* app, bool all) {
+    uint32_t kept = 0;
+
+    for(uint32_t i = 0; i < app->retired_pipeline_count; i++) {
+        retired_pipeline* retired = &app->retired_pipelines[i];
+
+        if(!all && !timeline_reached(app->device, retired->timeline, retired->value)) {
+            app->retired_pipelines[kept++] = *retired;
+            continue;
+        }
+
+        pipeline_compiler_release(&app->pipelines, retired->handle);
+        vkDestroyPipeline(app->device, retired->pipeline, NULL);
+    }
+
+    app->retired_pipeline_count = kept;
+}
+
+/**
+ * Blocks until the last present reached the display and records the
+ * latency from sampling its input. Does nothing unless low latency
+ * presentation is enabled, or if that present was already waited on.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void wait_for_last_present_(vk_app* app) {
+    if(!app->present_wait_enabled || app->present_id == app->waited_present_id) {
+        return;
+    }
+
+    VkResult result = app->wait_for_present(app->device, app->swapchain,
+        app->present_id, PRESENT_WAIT_TIMEOUT_NS);
+
+    // Timeouts happen while the window is hidden, and out of date
+    // swapchains get recreated by draw_frame_. Neither is worth a
+    // latency sample.
+    if(result == VK_SUCCESS) {
+        frame_time_history_add(&app->present_latencies,
+            (get_time_seconds() - app->present_input_time) * 1000.0);
+    }
+    else if(result != VK_TIMEOUT && result != VK_SUBOPTIMAL_KHR &&
+            result != VK_ERROR_OUT_OF_DATE_KHR) {
+        fprintf(stderr, "Unable to wait for present %llu\n",
+            (unsigned long long)app->present_id);
+    }
+
+    app->waited_present_id = app->present_id;
+}
+
+/**
+ * Gives up on a frame after its swapchain image was acquired. An
+ * empty submit waits on the acquire semaphore so it is unsignalled
+ * before its next use, and the swapchain is recreated to get the
+ * image back, as it can't be returned without presenting it.
+ * Headless frames acquire nothing and need no cleanup.
+ * 
+ * Params:
+ *   app   - vulkan app
+ *   frame - frame the image was acquired for
+ */
+void abandon_acquired_image_(vk_app* app, frame_context* frame) {
+    if(app->config.headless) {
+        return;
+    }
+
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &frame->image_available;
+    submit_info.pWaitDstStageMask = &wait_stage;
+
+    if(vkQueueSubmit(app->graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+        fprintf(stderr, "Unable to wait on the abandoned image's semaphore\n");
+    }
+
+    recreate_swapchain_(app);
+}
+
+void draw_frame_(vk_app* app) {
+    // Frame boundary, the only place pipelines are swapped
+    if(app->hot_reload_enabled) {
+        poll_shader_changes_(app);
+        update_pipeline_reloads_(app);
+    }
+
+    frame_context* frame = &app->frames[app->current_frame];
+
+    wait_timeline(app->device, app->graphics_timeline, frame->timeline_value);
+
+    // Its uniforms have been read, the segment can be rewritten
+    begin_uniform_segment(&app->uniforms, app->current_frame);
+
+    // Retiring the frame guarantees its queries are available
+    read_frame_timestamps_(app, app->current_frame);
+
+    // CPU time covers recording and submitting, not waiting on the
+    // GPU or the swapchain
+    double cpu_start = get_time_seconds();
+
+    // The frame has retired, so nothing from its pool is pending
+    VkCommandBuffer cmd = frame->cmd;
+    vkResetCommandPool(app->device, frame->cmd_pool, 0);
+
+    // Draws are skipped rather than waiting on a pipeline compile
+    app->frame_pipeline = pipeline_compiler_get(&app->pipelines,
+        app->graphics_pipeline);
+
+    // Everything that doesn't need the swapchain image is recorded
+    // before acquiring it, so these failures don't strand an image
+    if(!record_compute_cmd_(app, app->current_frame) ||
+            !record_secondary_draws_(app, app->current_frame)) {
+        return;
+    }
+    double cpu_ms = (get_time_seconds() - cpu_start) * 1000.0;
+
+    // Headless targets are owned per frame in flight, no need to acquire
+    uint32_t image_index = app->current_frame;
+    if(!app->config.headless) {
+        VkResult acquired = vkAcquireNextImageKHR(app->device, app->swapchain,
+            UINT64_MAX, frame->image_available,
+            VK_NULL_HANDLE, &image_index);
+
+        // Suboptimal still signals the semaphore, so render and recreate after
+        if(acquired == VK_ERROR_OUT_OF_DATE_KHR) {
+            recreate_swapchain_(app);
+            return;
+        }
+        else if(acquired != VK_SUCCESS && acquired != VK_SUBOPTIMAL_KHR) {
+            fprintf(stderr, "Unable to acquire swapchain image\n");
+            return;
+        }
+    }
+
+    // Images can come back out of order, wait for whichever frame
+    // rendered to this one last
+    swapchain_image* image = &app->swapchain_images[image_index];
+    wait_timeline(app->device, app->graphics_timeline, image->timeline_value);
+    cpu_start = get_time_seconds();
+
+    // Recorded before submitting either queue, so a failure can't
+    // advance the compute timeline without a matching graphics submit
+    if(!record_cmd_buffer_(app, cmd, app->current_frame, image_index)) {
+        abandon_acquired_image_(app, frame);
+        return;
+    }
+    frame->timestamps_pending = app->timestamps_supported;
+
+    uint64_t frame_value = app->frame_clock + 1;
+
+    // Animation runs on the compute queue while the previous frame
+    // is still rasterizing
+    VkTimelineSemaphoreSubmitInfo compute_timeline_info = {};
+    compute_timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    compute_timeline_info.signalSemaphoreValueCount = 1;
+    compute_timeline_info.pSignalSemaphoreValues = &frame_value;
+
+    VkSubmitInfo compute_submit = {};
+    compute_submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    compute_submit.pNext = &compute_timeline_info;
+    compute_submit.commandBufferCount = 1;
+    compute_submit.pCommandBuffers = &frame->compute_cmd;
+    compute_submit.signalSemaphoreCount = 1;
+    compute_submit.pSignalSemaphores = &app->compute_timeline;
+
+    VkResult result = vkQueueSubmit(app->compute_queue, 1, &compute_submit,
+        VK_NULL_HANDLE);
+
+    if(result != VK_SUCCESS) {
+        fprintf(stderr, "Unable to submit compute cmd\n");
+        abandon_acquired_image_(app, frame);
+        return;
+    }
+
+    // Compute has signalled frame_value, it must never be reused
+    app->frame_clock = frame_value;
+
+    // Values for binary semaphores are ignored
+    VkSemaphore wait_sems[] = {
+        app->compute_timeline,
+        frame->image_available
+    };
+    uint64_t wait_values[] = {frame_value, 0};
+    VkPipelineStageFlags wait_stages[] = {
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+    };
+
+    VkSemaphore signal_sems[] = {
+        app->graphics_timeline,
+        frame->render_finished
+    };
+    uint64_t signal_values[] = {frame_value, 0};
+
+    uint32_t wait_count = app->config.headless ? 1 : 2;
+    uint32_t signal_count = app->config.headless ? 1 : 2;
+
+    VkTimelineSemaphoreSubmitInfo timeline_info = {};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.waitSemaphoreValueCount = wait_count;
+    timeline_info.pWaitSemaphoreValues = wait_values;
+    timeline_info.signalSemaphoreValueCount = signal_count;
+    timeline_info.pSignalSemaphoreValues = signal_values;
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = &timeline_info;
+    submit_info.waitSemaphoreCount = wait_count;
     submit_info.pWaitSemaphores = wait_sems;
     submit_info.pWaitDstStageMask = wait_stages;
 
     submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &app->cmd_buffers[image_index];
+    submit_info.pCommandBuffers = &cmd;
 
-    VkSemaphore signal_sems[] = {app->render_finished[app->current_frame]};
-    submit_info.signalSemaphoreCount = 1;
+    submit_info.signalSemaphoreCount = signal_count;
     submit_info.pSignalSemaphores = signal_sems;
 
-    vkResetFences(app->device, 1, &app->in_flight[app->current_frame]);
-    VkResult result = vkQueueSubmit(app->graphics_queue, 1, &submit_info,
-        app->in_flight[app->current_frame]);
+    result = vkQueueSubmit(app->graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
 
     if(result != VK_SUCCESS) {
         fprintf(stderr, "Unable to submit draw cmd\n");
+        abandon_acquired_image_(app, frame);
+        return;
+    }
+
+    frame_time_history_add(&app->cpu_frame_times,
+        cpu_ms + (get_time_seconds() - cpu_start) * 1000.0);
+
+    frame->timeline_value = frame_value;
+    image->timeline_value = frame_value;
+
+    if(app->config.headless) {
+        app->current_frame = (app->current_frame + 1) % app->config.frames_in_flight;
         return;
     }
 
     VkPresentInfoKHR present = {};
     present.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     present.waitSemaphoreCount = 1;
-    present.pWaitSemaphores = signal_sems;
+    present.pWaitSemaphores = &frame->render_finished;
 
     VkSwapchainKHR swap_chains = { app->swapchain };
     present.swapchainCount = 1;
@@ -1410,13 +3664,115 @@ void draw_frame_(vk_app* app) {
     present.pImageIndices = &image_index;
     present.pResults = NULL;
 
+    // Tag the present so the next frame can wait for it to be shown
+    uint64_t present_id = app->present_id + 1;
+
+    VkPresentIdKHR present_id_info = {};
+    present_id_info.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    present_id_info.swapchainCount = 1;
+    present_id_info.pPresentIds = &present_id;
+
+    if(app->present_wait_enabled) {
+        present.pNext = &present_id_info;
+    }
+
     result = vkQueuePresentKHR(app->present_queue, &present);
 
-    if(result != VK_SUCCESS) {
-        fprintf(stderr, "Failed to draw frame");
+    if(app->present_wait_enabled &&
+            (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)) {
+        app->present_id = present_id;
+        app->present_input_time = app->input_time;
     }
 
-    app->current_frame = (app->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+    if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
+            app->framebuffer_resized) {
+        app->framebuffer_resized = false;
+        recreate_swapchain_(app);
+    }
+    else if(result != VK_SUCCESS) {
+        fprintf(stderr, "Failed to draw frame\n");
+    }
+
+    app->current_frame = (app->current_frame + 1) % app->config.frames_in_flight;
+}
+
+/**
+ * Draws one frame of the main loop. Windowed apps poll input first,
+ * after waiting for the last present in low latency mode.
+ * 
+ * Params:
+ *   app - vulkan app
+ * 
+ * Returns:
+ *   false once the window should close
+ */
+bool step_frame_(vk_app* app) {
+    if(!app->config.headless) {
+        if(glfwWindowShouldClose(app->app_window)) {
+            return false;
+        }
+
+        // In low latency mode input is only sampled once the previous
+        // frame is on screen, so nothing queues up behind it
+        wait_for_last_present_(app);
+
+        glfwPollEvents();
+        app->input_time = get_time_seconds();
+    }
+
+    draw_frame_(app);
+    return true;
+}
+
+/**
+ * Steps the instance count from 1 to MAX_BENCHMARK_INSTANCES by
+ * factors of ten, drawing config.instance_benchmark_frames frames at
+ * each count and printing their throughput and frame times. Every
+ * draw of the frame renders all instances, so a step renders
+ * scene_draw_count times as many copies as it has instances.
+ * 
+ * Params:
+ *   app - vulkan app
+ */
+void run_instance_benchmark_(vk_app* app) {
+    uint32_t step_frames = app->config.instance_benchmark_frames;
+
+    // Frames without the scene pipeline would only time clears
+    while(pipeline_compiler_status(&app->pipelines, app->graphics_pipeline) ==
+            PIPELINE_PENDING) {
+        if(!step_frame_(app)) {
+            return;
+        }
+    }
+
+    for(uint32_t count = 1; count <= MAX_BENCHMARK_INSTANCES; count *= 10) {
+        // The instance buffer is replaced, nothing may still read it
+        vkDeviceWaitIdle(app->device);
+        if(!upload_instances_(app, count)) {
+            return;
+        }
+
+        // Only this step's frames count towards its statistics
+        memset(&app->gpu_frame_times, 0, sizeof(frame_time_history));
+        memset(&app->cpu_frame_times, 0, sizeof(frame_time_history));
+
+        double start = get_time_seconds();
+        uint32_t frame_count = 0;
+        while(frame_count < step_frames && step_frame_(app)) {
+            frame_count++;
+        }
+        vkDeviceWaitIdle(app->device);
+        double elapsed = get_time_seconds() - start;
+
+        printf("%i instances x %i draws: %i frames in %.3f s (%.1f fps)\n",
+            count, app->config.scene_draw_count, frame_count, elapsed,
+            frame_count / elapsed);
+        print_frame_stats_(app);
+
+        if(frame_count < step_frames) {
+            return;
+        }
+    }
 }
 
 VkShaderModule create_shader_module(vk_app* app, const uint32_t* code, size_t code_len) {
@@ -1425,13 +3781,60 @@ VkShaderModule create_shader_module(vk_app* app, const uint32_t* code, size_t co
     info.codeSize = code_len;
     info.pCode = code;
 
-    VkShaderModule module;
+    VkShaderModule module = VK_NULL_HANDLE;
     VkResult result = vkCreateShaderModule(app->device, 
             &info, NULL, &module);
 
     if(result != VK_SUCCESS) {
-        fprintf(stderr, "Could not create shader module");
+        fprintf(stderr, "Could not create shader module\n");
+        module = VK_NULL_HANDLE;
+    }
+
+    return module;
+}
+
+/**
+ * Creates a shader module from the embedded SPIR-V for a shader, or
+ * from its override file if one is set. Shaders recompiled by hot
+ * reload take precedence over both. Override files are unmapped
+ * again as soon as the module exists, since the driver keeps its own
+ * copy of the code.
+ * 
+ * Params:
+ *   app        - vulkan app
+ *   name       - file name of the shader source, e.g. "shader.vert"
+ *   reflection - receives the shader's interface, may be NULL
+ * 
+ * Returns:
+ *   shader module, or VK_NULL_HANDLE on failure
+ */
+VkShaderModule load_shader_module_(vk_app* app, const char* name,
+        shader_reflection* reflection) {
+    shader_code spv;
+    bool loaded = false;
+
+    if(app->hot_reload_enabled && shader_watcher_has_compiled(&app->watcher, name)) {
+        loaded = load_shader_code_from(app->watcher.output_dir, name, &spv);
     }
+    else {
+        loaded = load_shader_code(name, &spv);
+    }
+
+    if(!loaded) {
+        fprintf(stderr, "Failed to load shader code for \"%s\"\n", name);
+        return VK_NULL_HANDLE;
+    }
+
+    // Reflect before the code goes away with an unmapped override
+    if(reflection != NULL && !reflect_spirv(spv.code, spv.size, reflection)) {
+        fprintf(stderr, "Failed to reflect \"%s\"\n", name);
+        release_shader_code(&spv);
+        return VK_NULL_HANDLE;
+    }
+
+    VkShaderModule module = create_shader_module(app, spv.code, spv.size);
+
+    release_shader_code(&spv);
 
     return module;
 }
@@ -1,14 +1,34 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "allocator.h"
+#include "bindless.h"
+#include "buffer.h"
+#include "compute.h"
+#include "config.h"
+#include "dynamic_state.h"
+#include "frame_stats.h"
+#include "layout_cache.h"
+#include "pipeline_compiler.h"
+#include "record_workers.h"
+#include "shader_watcher.h"
+#include "uniform_ring.h"
+
 #include <stdbool.h>
 
 /**
- * Holds indices of graphics families for a single physical device.
+ * Queue topology of a single physical device.
+ *
+ * transfer_family_index and compute_family_index point at families
+ * without graphics support when the device has them, so uploads and
+ * compute run alongside rendering. Otherwise they fall back to the
+ * graphics family.
  */
 typedef struct {
     int32_t graphics_family_index;
     int32_t present_family_index;
+    int32_t transfer_family_index;
+    int32_t compute_family_index;
     bool is_complete;
 } queue_families;
 
@@ -27,50 +47,263 @@ typedef struct {
 
 void cleanup_swapchain_details(swapchain_details*);
 
+/**
+ * A single vertex as laid out in the vertex buffer. Shaders read
+ * these as plain floats from the bindless table.
+ */
+typedef struct {
+    float pos[2];
+    float color[3];
+} vertex;
+
+/**
+ * Push constants of the vertex animation compute shader. Buffers are
+ * bindless table indices.
+ */
+typedef struct {
+    float time;
+    uint32_t vertex_count;
+    uint32_t base_buffer;
+    uint32_t animated_buffer;
+} animate_params;
+
+/**
+ * Push constants of the scene's vertex shader.
+ */
+typedef struct {
+    // Bindless index of the vertices to draw
+    uint32_t vertex_buffer;
+} draw_params;
+
+/**
+ * Per-draw uniform block of the scene's vertex shader, std140. Each
+ * draw places the scene in its own cell of a grid.
+ */
+typedef struct {
+    float offset[2];
+    float scale;
+    float pad;
+} draw_uniforms;
+
+/**
+ * Per-instance vertex attributes of the scene's vertex shader, read
+ * at instance input rate. transform is offset x and y, scale and
+ * rotation in radians, color tints the instance's vertex colors.
+ */
+typedef struct {
+    float transform[4];
+    float color[4];
+} instance_data;
+
+// Frame contexts are padded to whole cache lines of this size
+#define FRAME_CONTEXT_ALIGNMENT 64
+
+/**
+ * Everything owned by a single frame in flight. All of it can be
+ * reused once graphics_timeline reaches timeline_value.
+ */
+typedef struct {
+    // Primary graphics commands, the pool is reset as a whole
+    _Alignas(FRAME_CONTEXT_ALIGNMENT) VkCommandPool cmd_pool;
+    VkCommandBuffer cmd;
+
+    // Async compute commands and the vertices they animate
+    VkCommandPool compute_cmd_pool;
+    VkCommandBuffer compute_cmd;
+    gpu_buffer animated_vertices;
+    uint32_t animated_vertices_index;
+
+    // Binary semaphores, the swapchain can't use timelines
+    VkSemaphore image_available;
+    VkSemaphore render_finished;
+
+    uint64_t timeline_value;
+
+    // Two-entry timestamp pool bracketing the frame's render pass
+    VkQueryPool timestamp_pool;
+    bool timestamps_pending;
+} frame_context;
+
+/**
+ * A swapchain image, or offscreen target when headless, and the
+ * objects rendering to it goes through.
+ */
+typedef struct {
+    VkImage image;
+    VkImageView view;
+    VkFramebuffer framebuffer;
+
+    // Only used in headless mode, backs the offscreen image
+    gpu_allocation memory;
+
+    // graphics_timeline value of the last frame rendered to it
+    uint64_t timeline_value;
+} swapchain_image;
+
+// Replaced pipelines that can wait for their frames to retire
+#define MAX_RETIRED_PIPELINES 8
+
+/**
+ * A pipeline replaced by a shader reload, destroyed once timeline
+ * reaches value. Graphics pipelines belong to the pipeline compiler
+ * and are released through handle, compute pipelines are destroyed
+ * directly.
+ */
+typedef struct {
+    pipeline_handle handle;
+    VkPipeline pipeline;
+
+    VkSemaphore timeline;
+    uint64_t value;
+} retired_pipeline;
+
 /**
  * Represents a vulkan application. Holds all relevant structs and
- * data.
+ * data. How it runs is controlled by the vk_app_config passed to
+ * init_vk_app.
  */
 typedef struct {
+    vk_app_config config;
+
     GLFWwindow* app_window;
+    bool framebuffer_resized;
     VkInstance instance;
     VkDebugUtilsMessengerEXT debug_messenger;
     VkSurfaceKHR surface;
     VkPhysicalDevice physical_device;
     VkDevice device;
+
+    // Resolved once when the physical device is picked. Roles that
+    // share a family also share a queue.
+    queue_families queue_topology;
     VkQueue graphics_queue;
     VkQueue present_queue;
+    VkQueue transfer_queue;
+    VkQueue compute_queue;
+
+    // Every buffer and image is backed by memory from here
+    gpu_allocator allocator;
 
     VkSurfaceFormatKHR swapchain_format;
     VkExtent2D swapchain_extent;
     VkSwapchainKHR swapchain;
-    VkImage* swapchain_images;
+    swapchain_image* swapchain_images;
     uint32_t swapchain_image_count;
 
-    VkImageView* swapchain_image_views;
+    // With dynamic rendering the pipeline is built against the
+    // swapchain format and no render pass or framebuffers exist
+    bool dynamic_rendering_enabled;
+    PFN_vkCmdBeginRenderingKHR cmd_begin_rendering;
+    PFN_vkCmdEndRenderingKHR cmd_end_rendering;
 
     VkRenderPass render_pass;
+    VkPipelineCache pipeline_cache;
+
+    // Layouts are derived from the shaders' SPIR-V and owned by
+    // layouts, pipelines with the same interface share them
+    layout_cache layouts;
     VkPipelineLayout pipeline_layout;
-    VkPipeline graphics_pipeline;
 
-    VkFramebuffer* framebuffers;
-    uint32_t framebuffer_count;
+    // Every buffer and texture shaders read, bound once per command
+    // buffer at BINDLESS_SET of every pipeline layout
+    bindless_table bindless;
+
+    // Per-frame uniform data. Each frame's draws get one contiguous
+    // run of draw_uniforms blocks starting at draw_uniforms_offset.
+    uniform_ring uniforms;
+    uint32_t draw_uniforms_offset;
+    uint32_t draw_uniforms_stride;
+
+    // The scene pipeline compiles in the background. frame_pipeline
+    // is what the frame being recorded draws with, VK_NULL_HANDLE
+    // while nothing is ready yet.
+    pipeline_compiler pipelines;
+    pipeline_handle graphics_pipeline;
+    VkPipeline frame_pipeline;
+
+    // Shader hot reload. A rebuilt scene pipeline waits in
+    // pending_graphics_pipeline until it has compiled and is swapped
+    // in at the start of a frame.
+    bool hot_reload_enabled;
+    shader_watcher watcher;
+    pipeline_handle pending_graphics_pipeline;
+    VkPipelineLayout pending_pipeline_layout;
+    retired_pipeline retired_pipelines[MAX_RETIRED_PIPELINES];
+    uint32_t retired_pipeline_count;
+
+    // Viewport and scissor are always dynamic, the rest of
+    // scene_draw_state only when the device allows it
+    dynamic_state_table dynamic_state;
+    draw_state scene_draw_state;
+
+    // Ring of config.frames_in_flight contexts, indexed by current_frame
+    frame_context* frames;
+
+    // Draws of the frame being recorded. With workers they are
+    // recorded into frame_secondary_count of secondary_cmds before
+    // the swapchain image is acquired.
+    record_workers workers;
+    VkCommandBuffer* secondary_cmds;
+    uint32_t frame_draw_count;
+    uint32_t frame_secondary_count;
 
-    VkCommandPool cmd_pool;
-    VkCommandBuffer* cmd_buffers;
-    uint32_t cmd_buffer_count;
+    buffer_uploader uploader;
+    gpu_buffer index_buffer;
+    uint32_t index_count;
 
-    VkSemaphore* image_available;
-    VkSemaphore* render_finished;
-    VkFence* in_flight;
-    VkFence* imgs_in_flight;
+    // Rest pose of the scene, only read by the compute pass
+    gpu_buffer vertex_buffer;
+    uint32_t vertex_buffer_index;
+    uint32_t vertex_count;
+
+    // Per-instance transforms and colors, bound as a vertex buffer.
+    // Every draw renders instance_count copies of the scene.
+    gpu_buffer instance_buffer;
+    uint32_t instance_count;
+
+    // Async compute animates vertex_buffer into each frame's
+    // animated_vertices on the compute queue. Graphics waits on the
+    // compute timeline and, if the families differ, acquires the
+    // buffer the compute queue released.
+    compute_pipeline animate_pipeline;
+    double start_time;
+
+    // Frame clock. Frame N's compute and graphics submits signal N on
+    // their queue's timeline. A frame context or swapchain image can
+    // be reused once graphics_timeline reaches the value it was last
+    // submitted with, graphics always waits on compute first.
+    VkSemaphore graphics_timeline;
+    VkSemaphore compute_timeline;
+    uint64_t frame_clock;
+
+    // GPU timing, queries live in the frame contexts
+    bool timestamps_supported;
+    float timestamp_period;
+    uint64_t timestamp_mask;
+
+    frame_time_history gpu_frame_times;
+    frame_time_history cpu_frame_times;
+
+    // Low latency presentation. Only enabled when the config asks for
+    // it and the device has VK_KHR_present_id and VK_KHR_present_wait.
+    // present_id is the last ID presented to the current swapchain.
+    bool present_wait_enabled;
+    PFN_vkWaitForPresentKHR wait_for_present;
+    uint64_t present_id;
+    uint64_t waited_present_id;
+    double input_time;
+    double present_input_time;
+    frame_time_history present_latencies;
 
     size_t current_frame;
 } vk_app;
 
 // "Public" interface
-bool init_vk_app(vk_app*);
+bool init_vk_app(vk_app*, const vk_app_config*);
 void cleanup_vk_app(vk_app*);
 
 void run_vk_app(vk_app*);
 
+vk_app_frame_stats vk_app_get_frame_stats(const vk_app*);
+gpu_allocator_stats vk_app_get_memory_stats(const vk_app*);
+